@@ -43,9 +43,43 @@ outw(uint addr, uint data)
     asm volatile("str %1,[%0]" : : "r"(addr), "r"(data));
 }
 
+// Atomically store newval in *addr and return the old value.
+static inline uint
+xchg(volatile uint *addr, uint newval)
+{
+    uint old, fail;
+
+    do{
+        asm volatile("ldrex %0, [%2]\n\t"
+                     "strex %1, %3, [%2]"
+                     : "=&r"(old), "=&r"(fail)
+                     : "r"(addr), "r"(newval)
+                     : "memory");
+    }while(fail);
+    return old;
+}
+
+// Count leading zeros; 32 if x is 0.
+static inline uint
+clz(uint x)
+{
+    uint n;
+
+    asm("clz %0, %1" : "=r"(n) : "r"(x));
+    return n;
+}
+
+// Data memory barrier, in the CP15 form that both the ARM1176
+// and the Cortex-A7 understand.
+static inline void
+dmb(void)
+{
+    asm volatile("mcr p15, 0, %0, c7, c10, 5" : : "r"(0) : "memory");
+}
+
 
 // Layout of the trap frame built on the stack
-// by exception.s, and passed to trap().
+// by exception.S, and passed to trap().
 struct trapframe {
   uint sp; // user mode sp
   uint r0;
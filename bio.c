@@ -10,12 +10,31 @@
 // * After changing buffer data, call bwrite to write it to disk.
 // * When done with the buffer, call brelse.
 // * Do not use the buffer after calling brelse.
+// * breadn and bwriten do the same for a run of consecutive
+//     blocks, in one disk request, each block in its own buffer.
 // * Only one process at a time can use a buffer,
 //     so do not keep them longer than necessary.
-// 
-// The implementation uses three state flags internally:
-// * B_BUSY: the block has been returned from bread
-//     and has not been passed back to brelse.  
+//
+// Each buffer has a sleep lock, held from bread until brelse,
+// and a reference count of the processes holding or waiting
+// for it; only unreferenced buffers are recycled.
+//
+// The buffers are allocated at boot, from 1/2^BCACHESHIFT of the
+// free memory, and are found through a hash table on (dev, blockno).
+//
+// Replacement is 2Q, so that one long sequential read cannot push
+// the inode, bitmap and directory blocks out of the cache:
+// * A1in: a FIFO of blocks read once.  Further hits while a
+//     block is still here (a scan reading it a piece at a time)
+//     do not count as reuse.
+// * A1out: the blocks recently dropped from A1in, kept as ghost
+//     entries without data.
+// * Am: an LRU list of blocks read again after they reached
+//     A1out, which are the ones worth keeping.
+// A1in gets a quarter of the buffers; A1out remembers as many
+// blocks as half the buffers.
+//
+// The implementation uses two state flags internally:
 // * B_VALID: the buffer data has been read from the disk.
 // * B_DIRTY: the buffer data has been modified
 //     and needs to be written to disk.
@@ -23,119 +42,416 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "fs.h"
+#include "mmu.h"
 #include "spinlock.h"
+#include "sleeplock.h"
 #include "buf.h"
+#include "iostat.h"
+
+#define NBUCKET 1024  // a power of two
+#define HASH(dev, blockno) (((dev)*31 + (blockno)) & (NBUCKET-1))
+
+// A block in A1out.
+struct ghost {
+  uint dev;           // -1 once reloaded
+  uint blockno;
+  struct ghost *hnext;  // hash chain
+  struct ghost *next;   // A1out FIFO, oldest first
+};
 
 struct {
   struct spinlock lock;
-  struct buf buf[NBUF];
+  int nbuf;
+  uint hits;
+  uint misses;
+  uint readahead;
+  uint lockus;
+
+  // Buffers on A1in and Am, through prev/next.
+  // head.next is the newest, head.prev the next to go.
+  struct buf a1in;
+  struct buf am;
+  int na1in;
 
-  // Linked list of all buffers, through prev/next.
-  // head.next is most recently used.
-  struct buf head;
+  // Cached buffers by (dev, blockno), through hnext.
+  struct buf *hash[NBUCKET];
+
+  // A1out; every ghost is on the FIFO, live ones also hashed.
+  struct ghost *gfirst;
+  struct ghost *glast;
+  struct ghost *ghash[NBUCKET];
 } bcache;
 
+static void
+listinit(struct buf *head)
+{
+  head->prev = head;
+  head->next = head;
+}
+
+static void
+listremove(struct buf *b)
+{
+  b->next->prev = b->prev;
+  b->prev->next = b->next;
+}
+
+// Insert b at the head of list.
+static void
+listpush(struct buf *head, struct buf *b)
+{
+  b->next = head->next;
+  b->prev = head;
+  head->next->prev = b;
+  head->next = b;
+}
+
+// Add b, with its data at data, to A1in.
+static void
+badd(struct buf *b, uchar *data)
+{
+  memset(b, 0, sizeof(*b));
+  b->dev = -1;
+  b->data = data;
+  b->queue = B_A1IN;
+  initsleeplock(&b->lock, "buffer");
+  listpush(&bcache.a1in, b);
+  bcache.na1in++;
+  bcache.nbuf++;
+}
+
+// Add the ghosts in one page to A1out.
+static void
+gaddpage(char *page)
+{
+  struct ghost *g;
+
+  for(g = (struct ghost*)page; g+1 <= (struct ghost*)(page+PGSIZE); g++){
+    g->dev = -1;
+    g->hnext = 0;
+    g->next = 0;
+    if(bcache.glast)
+      bcache.glast->next = g;
+    else
+      bcache.gfirst = g;
+    bcache.glast = g;
+  }
+}
+
+// Call after kinit2, to size the cache from the free memory.
 void
 binit(void)
 {
-  struct buf *b;
+  char *page, *hdr, *data;
+  int nbuf, nhdr, ndata, nghost;
 
   memset(&bcache, 0, sizeof(bcache));
   initlock(&bcache.lock, "bcache");
 
 //PAGEBREAK!
-  // Create linked list of buffers
-  bcache.head.prev = &bcache.head;
-  bcache.head.next = &bcache.head;
-  for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    b->dev = -1;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+  listinit(&bcache.a1in);
+  listinit(&bcache.am);
+  // The data comes in whole pages, the headers packed in others.
+  nbuf = (kfreepages() >> BCACHESHIFT) * (PGSIZE/BSIZE);
+  if(nbuf < NBUF)
+    nbuf = NBUF;
+  hdr = data = 0;
+  nhdr = ndata = 0;
+  while(bcache.nbuf < nbuf){
+    if(nhdr == 0){
+      if((hdr = kalloc()) == 0)
+        panic("binit");
+      nhdr = PGSIZE/sizeof(struct buf);
+    }
+    if(ndata == 0){
+      if((data = kalloc()) == 0)
+        panic("binit");
+      ndata = PGSIZE/BSIZE;
+    }
+    badd((struct buf*)hdr + --nhdr, (uchar*)data + --ndata*BSIZE);
   }
+  for(nghost = 0; nghost < bcache.nbuf/2; nghost += PGSIZE/sizeof(struct ghost)){
+    if((page = kalloc()) == 0)
+      panic("binit");
+    gaddpage(page);
+  }
+  cprintf("bcache: %d buffers\n", bcache.nbuf);
 }
 
-// Look through buffer cache for sector on device dev.
-// If not found, allocate fresh block.
-// In either case, return B_BUSY buffer.
+// Remove b from its hash chain, if it is on one.
+static void
+bunhash(struct buf *b)
+{
+  struct buf **pp;
+
+  for(pp = &bcache.hash[HASH(b->dev, b->blockno)]; *pp; pp = &(*pp)->hnext){
+    if(*pp == b){
+      *pp = b->hnext;
+      break;
+    }
+  }
+  b->hnext = 0;
+}
+
+// Remove g from its hash chain, if it is on one.  It stays on
+// the FIFO until its turn comes to be reused.
+static void
+gunhash(struct ghost *g)
+{
+  struct ghost **pp;
+
+  for(pp = &bcache.ghash[HASH(g->dev, g->blockno)]; *pp; pp = &(*pp)->hnext){
+    if(*pp == g){
+      *pp = g->hnext;
+      break;
+    }
+  }
+  g->hnext = 0;
+  g->dev = -1;
+}
+
+// Remember that blockno left A1in, forgetting the oldest ghost.
+static void
+gadd(uint dev, uint blockno)
+{
+  struct ghost *g;
+  uint h;
+
+  g = bcache.gfirst;
+  if(g == 0)
+    return;
+  gunhash(g);
+  bcache.gfirst = g->next;
+  g->next = 0;
+  if(bcache.gfirst)
+    bcache.glast->next = g;
+  else
+    bcache.gfirst = g;
+  bcache.glast = g;
+
+  g->dev = dev;
+  g->blockno = blockno;
+  h = HASH(dev, blockno);
+  g->hnext = bcache.ghash[h];
+  bcache.ghash[h] = g;
+}
+
+// Is blockno in A1out?  If so, take it out.
+static int
+gtake(uint dev, uint blockno)
+{
+  struct ghost *g;
+
+  for(g = bcache.ghash[HASH(dev, blockno)]; g; g = g->hnext){
+    if(g->dev == dev && g->blockno == blockno){
+      gunhash(g);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Find an unused, clean buffer on list, oldest first.
 static struct buf*
-bget(uint dev, uint sector)
+victim(struct buf *head)
+{
+  struct buf *b;
+
+  for(b = head->prev; b != head; b = b->prev)
+    if(b->refcnt == 0 && (b->flags & B_DIRTY) == 0)
+      return b;
+  return 0;
+}
+
+// Look through buffer cache for block blockno on device dev.
+// If not found, allocate fresh block.
+// In either case, return locked buffer.
+// Callers other than bread() must be about to overwrite
+// all of its contents.
+struct buf*
+bget(uint dev, uint blockno)
 {
   struct buf *b;
+  uint h, t0;
 
   acquire(&bcache.lock);
 
- loop:
-  // Is the sector already cached?
-  for(b = bcache.head.next; b != &bcache.head; b = b->next){
-    if(b->dev == dev && b->sector == sector){
-      if(!(b->flags & B_BUSY)){
-        b->flags |= B_BUSY;
+  // Is the block already cached?
+  h = HASH(dev, blockno);
+  for(b = bcache.hash[h]; b; b = b->hnext){
+    if(b->dev == dev && b->blockno == blockno){
+      b->refcnt++;
+      bcache.hits++;
+      release(&bcache.lock);
+      t0 = getsystemtimelo();
+      acquiresleep(&b->lock);
+      if((t0 = getsystemtimelo() - t0) > 0){
+        acquire(&bcache.lock);
+        bcache.lockus += t0;
         release(&bcache.lock);
-        return b;
       }
-      sleep(b, &bcache.lock);
-      goto loop;
+      return b;
     }
   }
 
-  // Not cached; recycle some non-busy and clean buffer.
-  for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
-    if((b->flags & B_BUSY) == 0 && (b->flags & B_DIRTY) == 0){
-      b->dev = dev;
-      b->sector = sector;
-      b->flags = B_BUSY;
-      release(&bcache.lock);
-      return b;
-    }
+  // Not cached; recycle some unused and clean buffer, from
+  // A1in while it is over its share.
+  bcache.misses++;
+  b = 0;
+  if(bcache.na1in > bcache.nbuf/4)
+    b = victim(&bcache.a1in);
+  if(b == 0)
+    b = victim(&bcache.am);
+  if(b == 0)
+    b = victim(&bcache.a1in);
+  if(b == 0)
+    panic("bget: no buffers");
+
+  listremove(b);
+  if(b->queue == B_A1IN){
+    bcache.na1in--;
+    if(b->dev != -1)
+      gadd(b->dev, b->blockno);
   }
-  panic("bget: no buffers");
-  return 0;
+  bunhash(b);
+  b->dev = dev;
+  b->blockno = blockno;
+  b->flags = 0;
+  b->refcnt = 1;
+  b->hnext = bcache.hash[h];
+  bcache.hash[h] = b;
+  if(gtake(dev, blockno)){
+    b->queue = B_AM;
+    listpush(&bcache.am, b);
+  } else {
+    b->queue = B_A1IN;
+    listpush(&bcache.a1in, b);
+    bcache.na1in++;
+  }
+  release(&bcache.lock);
+  acquiresleep(&b->lock);
+  return b;
 }
 
-// Return a B_BUSY buf with the contents of the indicated disk sector.
+// Return a locked buf with the contents of the indicated disk block.
 struct buf*
-bread(uint dev, uint sector)
+bread(uint dev, uint blockno)
 {
   struct buf *b;
 
-  b = bget(dev, sector);
+  b = bget(dev, blockno);
   if(!(b->flags & B_VALID))
-    iderw(b);
+    blkrw(b);
   return b;
 }
 
-// Write b's contents to disk.  Must be B_BUSY.
+// Start reading blockno into the cache for a bread expected
+// soon, unless it is there already.  Does not wait: the block
+// layer releases the buffer when the read is done, and a bread
+// of it meanwhile waits for the buffer's lock.
+void
+breadahead(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  if(b->flags & B_VALID){
+    brelse(b);
+    return;
+  }
+  acquire(&bcache.lock);
+  bcache.readahead++;
+  release(&bcache.lock);
+  blkstart(b);
+}
+
+// Return in b[] locked bufs with the contents of the n blocks
+// from blockno on, reading those not cached in one request.
+void
+breadn(uint dev, uint blockno, int n, struct buf **b)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    b[i] = bget(dev, blockno + i);
+  blkrwn(b, n);
+}
+
+// Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
 {
-  if((b->flags & B_BUSY) == 0)
+  if(!holdingsleep(&b->lock))
     panic("bwrite");
   b->flags |= B_DIRTY;
-  iderw(b);
+  blkrw(b);
 }
 
-// Release a B_BUSY buffer.
-// Move to the head of the MRU list.
+// Write the contents of the n locked bufs in b[] to disk, in
+// one request where their blocks are consecutive.
 void
-brelse(struct buf *b)
+bwriten(struct buf **b, int n)
 {
-  if((b->flags & B_BUSY) == 0)
-    panic("brelse");
+  int i;
 
-  acquire(&bcache.lock);
+  for(i = 0; i < n; i++){
+    if(!holdingsleep(&b[i]->lock))
+      panic("bwriten");
+    b[i]->flags |= B_DIRTY;
+  }
+  blkrwn(b, n);
+}
 
-  b->next->prev = b->prev;
-  b->prev->next = b->next;
-  b->next = bcache.head.next;
-  b->prev = &bcache.head;
-  bcache.head.next->prev = b;
-  bcache.head.next = b;
+// Start writing b's contents to disk and return.  Must be
+// locked; the block layer releases it when the write is done.
+void
+bawrite(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bawrite");
+  b->flags |= B_DIRTY;
+  blkstart(b);
+}
 
-  b->flags &= ~B_BUSY;
-  wakeup(b);
+// Release a locked buffer.
+// A buffer on Am moves to its head once nobody wants it;
+// A1in keeps the order in which blocks arrived.
+void
+brelse(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("brelse");
+  bput(b);
+}
+
+// Release a locked buffer on behalf of whoever locked it.
+// The block layer calls this, maybe in an interrupt handler,
+// when a blkstart() transfer is done.
+void
+bput(struct buf *b)
+{
+  releasesleep(&b->lock);
 
+  acquire(&bcache.lock);
+  b->refcnt--;
+  if(b->refcnt == 0 && b->queue == B_AM){
+    listremove(b);
+    listpush(&bcache.am, b);
+  }
   release(&bcache.lock);
 }
 
+// Copy the cache statistics to st.
+void
+bstat(struct iostat *st)
+{
+  acquire(&bcache.lock);
+  st->bsize = BSIZE;
+  st->nbuf = bcache.nbuf;
+  st->hits = bcache.hits;
+  st->misses = bcache.misses;
+  st->readahead = bcache.readahead;
+  st->lockus = bcache.lockus;
+  release(&bcache.lock);
+}
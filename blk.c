@@ -0,0 +1,306 @@
+// Block request layer.
+//
+// bio.c hands locked buffers to blkrw() or, a run of them at
+// once, blkrwn(), which wait for the transfer, or blkstart(),
+// which does not (for readahead).
+// Each device keeps its waiting requests on a queue sorted by
+// block and serves them in C-LOOK order: ascending from the
+// last block transferred, then back to the lowest.  Requests
+// for consecutive blocks in the same direction are merged into
+// one transfer of up to maxmerge buffers.  The driver says when
+// a transfer is complete by calling blkdone(), which wakes the
+// waiting bread() and starts the next transfer.
+//
+// The raw disk device (major DISK) reads and writes the blocks
+// of block device minor through the buffer cache.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "buf.h"
+#include "blk.h"
+#include "iostat.h"
+
+static struct blkdev *blkdevs[NBLKDEV];
+
+void
+blkregister(int dev, struct blkdev *d)
+{
+  if(dev < 0 || dev >= NBLKDEV || blkdevs[dev])
+    panic("blkregister");
+  initlock(&d->lock, d->name);
+  d->queue = 0;
+  d->active = 0;
+  d->next = 0;
+  d->reads = d->writes = d->rblocks = d->wblocks = 0;
+  d->busyus = d->waitus = 0;
+  if(d->maxmerge < 1)
+    d->maxmerge = 1;
+  blkdevs[dev] = d;
+}
+
+static struct blkdev*
+getdev(struct buf *b)
+{
+  if(b->dev >= NBLKDEV || blkdevs[b->dev] == 0)
+    panic("blk: no such device");
+  return blkdevs[b->dev];
+}
+
+// Add b to the queue, keeping it in block order.
+static void
+enqueue(struct blkdev *d, struct buf *b)
+{
+  struct buf **pp;
+
+  for(pp = &d->queue; *pp && (*pp)->blockno < b->blockno; pp = &(*pp)->qnext)
+    ;
+  b->qnext = *pp;
+  *pp = b;
+}
+
+// Take the next transfer off the queue: the first request at or
+// after d->next, or else the lowest, and the requests for the
+// blocks after it that go the same way.  Return its first
+// buffer and set *pn to the number of buffers.
+static struct buf*
+dequeue(struct blkdev *d, int *pn)
+{
+  struct buf **pp, *first, *last;
+  int n;
+
+  for(pp = &d->queue; *pp && (*pp)->blockno < d->next; pp = &(*pp)->qnext)
+    ;
+  if(*pp == 0)
+    pp = &d->queue;
+  first = last = *pp;
+  for(n = 1; n < d->maxmerge && last->qnext; n++){
+    if(last->qnext->blockno != last->blockno + 1 ||
+       (last->qnext->flags & B_DIRTY) != (first->flags & B_DIRTY))
+      break;
+    last = last->qnext;
+  }
+  *pp = last->qnext;
+  last->qnext = 0;
+  d->next = last->blockno + 1;
+  *pn = n;
+  return first;
+}
+
+// The active transfer is complete: mark its buffers and wake
+// their waiters, or release those that nobody waits for.
+static void
+finish(struct blkdev *d)
+{
+  struct buf *b, *next;
+
+  d->busyus += getsystemtimelo() - d->started;
+  for(b = d->active; b; b = next){
+    next = b->qnext;
+    b->qnext = 0;
+    b->flags = (b->flags | B_VALID) & ~B_DIRTY;
+    if(b->flags & B_ASYNC){
+      b->flags &= ~B_ASYNC;
+      bput(b);
+    } else
+      wakeup(b);
+  }
+  d->active = 0;
+}
+
+// Start transfers until the device is busy or has nothing to do.
+static void
+kick(struct blkdev *d)
+{
+  struct buf *b;
+  int n;
+
+  while(d->active == 0 && d->queue){
+    b = dequeue(d, &n);
+    d->active = b;
+    if(b->flags & B_DIRTY){
+      d->writes++;
+      d->wblocks += n;
+    } else {
+      d->reads++;
+      d->rblocks += n;
+    }
+    d->started = getsystemtimelo();
+    if(d->start(d, b, n))
+      finish(d);
+  }
+}
+
+// Start reading or writing b and return.  The block layer
+// releases b when the transfer is done.
+void
+blkstart(struct buf *b)
+{
+  struct blkdev *d;
+
+  d = getdev(b);
+  acquire(&d->lock);
+  b->flags |= B_ASYNC;
+  enqueue(d, b);
+  kick(d);
+  release(&d->lock);
+}
+
+// Sync buf with disk.
+// If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
+// Else if B_VALID is not set, read buf from disk, set B_VALID.
+void
+blkrw(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("blkrw: buf not locked");
+  if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
+    panic("blkrw: nothing to do");
+  blkrwn(&b, 1);
+}
+
+// Sync the n locked bufs in b[], all on one device, as blkrw()
+// does, skipping any with nothing to do.  They are queued
+// together, so consecutive blocks go in one transfer.
+void
+blkrwn(struct buf **b, int n)
+{
+  struct blkdev *d;
+  uint t0;
+  int i;
+
+  for(i = 0; i < n; i++)
+    if(!holdingsleep(&b[i]->lock))
+      panic("blkrwn: buf not locked");
+
+  d = getdev(b[0]);
+  acquire(&d->lock);
+  for(i = 0; i < n; i++)
+    if((b[i]->flags & (B_VALID|B_DIRTY)) != B_VALID)
+      enqueue(d, b[i]);
+  kick(d);
+  t0 = getsystemtimelo();
+  for(i = 0; i < n; i++)
+    while((b[i]->flags & (B_VALID|B_DIRTY)) != B_VALID)
+      sleep(b[i], &d->lock);
+  d->waitus += getsystemtimelo() - t0;
+  release(&d->lock);
+}
+
+// Called by a driver when the transfer it was given by start()
+// is complete.  Safe in interrupt handlers.
+void
+blkdone(struct blkdev *d)
+{
+  acquire(&d->lock);
+  if(d->active == 0)
+    panic("blkdone");
+  finish(d);
+  kick(d);
+  release(&d->lock);
+}
+
+// Copy the device statistics to st.
+void
+blkstat(struct iostat *st)
+{
+  struct blkdev *d;
+  struct iodev *io;
+  int i;
+
+  for(i = 0; i < NBLKDEV; i++){
+    io = &st->dev[i];
+    memset(io, 0, sizeof(*io));
+    if((d = blkdevs[i]) == 0)
+      continue;
+    acquire(&d->lock);
+    safestrcpy(io->name, d->name, sizeof(io->name));
+    io->size = d->size;
+    io->reads = d->reads;
+    io->writes = d->writes;
+    io->rblocks = d->rblocks;
+    io->wblocks = d->wblocks;
+    io->busyus = d->busyus;
+    io->waitus = d->waitus;
+    release(&d->lock);
+  }
+}
+
+//PAGEBREAK!
+#define DISKBATCH 32    // blocks queued at once by the raw device
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+// Raw disk reads and writes, a block at a time.  Each batch of
+// blocks is queued before any is waited for, so the block layer
+// can merge them.
+static int
+diskrw(struct inode *ip, char *p, uint off, int n, int write)
+{
+  struct blkdev *d;
+  struct buf *b;
+  uint bn, first, last, nblock, end;
+  int tot, m;
+
+  if(ip->minor < 0 || ip->minor >= NBLKDEV || (d = blkdevs[ip->minor]) == 0)
+    return -1;
+  // File offsets reach only the first 4GB.
+  nblock = d->size / (BSIZE/SECTSIZE);
+  end = nblock < 0xFFFFFFFF/BSIZE ? nblock*BSIZE : 0xFFFFFFFF/BSIZE*BSIZE;
+  if(off >= end || n <= 0)
+    return 0;
+  if(n > end - off)
+    n = end - off;
+
+  for(tot = 0; tot < n; ){
+    first = (off + tot) / BSIZE;
+    last = (off + n - 1) / BSIZE;
+    if(last >= first + DISKBATCH)
+      last = first + DISKBATCH - 1;
+    if(!write){
+      for(bn = first; bn <= last; bn++)
+        breadahead(ip->minor, bn);
+    }
+    for(bn = first; bn <= last; bn++, tot += m){
+      m = min(n - tot, BSIZE - (off + tot) % BSIZE);
+      if(write){
+        // Whole blocks need not be read first.
+        b = m == BSIZE ? bget(ip->minor, bn) : bread(ip->minor, bn);
+        memmove(b->data + (off + tot) % BSIZE, p + tot, m);
+        bawrite(b);
+      } else {
+        b = bread(ip->minor, bn);
+        memmove(p + tot, b->data + (off + tot) % BSIZE, m);
+        brelse(b);
+      }
+    }
+    if(write){
+      // Wait for the batch.
+      for(bn = first; bn <= last; bn++)
+        brelse(bread(ip->minor, bn));
+    }
+  }
+  return n;
+}
+
+static int
+diskread(struct inode *ip, char *dst, uint off, int n)
+{
+  return diskrw(ip, dst, off, n, 0);
+}
+
+static int
+diskwrite(struct inode *ip, char *src, uint off, int n)
+{
+  return diskrw(ip, src, off, n, 1);
+}
+
+void
+diskinit(void)
+{
+  devsw[DISK].read = diskread;
+  devsw[DISK].write = diskwrite;
+}
@@ -0,0 +1,25 @@
+// A block device driver, as registered with blkregister().
+// The block layer (blk.c) queues requests in block order and
+// hands the driver one transfer at a time.
+struct blkdev {
+  char *name;
+
+  // Start a transfer of the n buffers chained through qnext,
+  // which hold consecutive blocks from b->blockno on and are all
+  // reads or (B_DIRTY) all writes.  Return 1 if the transfer is
+  // already complete, or 0 if the driver will call blkdone()
+  // when it is, usually from its interrupt handler.
+  int (*start)(struct blkdev *d, struct buf *b, int n);
+  int maxmerge;           // most buffers in one transfer
+  uint size;              // SECTSIZE sectors on the device
+
+  // Owned by blk.c.
+  struct spinlock lock;
+  struct buf *queue;      // waiting requests, by block
+  struct buf *active;     // the transfer in progress
+  uint next;              // block after the last transfer
+  uint started;           // when the active transfer started
+  uint reads, writes;     // statistics; see iostat.h
+  uint rblocks, wblocks;
+  uint busyus, waitus;
+};
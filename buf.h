@@ -1,13 +1,20 @@
 struct buf {
   int flags;
   uint dev;
-  uint sector;
-  struct buf *prev; // LRU cache list
+  uint blockno;
+  struct sleeplock lock;
+  uint refcnt;
+  int queue;        // B_A1IN or B_AM; see bio.c
+  struct buf *prev; // that queue
   struct buf *next;
+  struct buf *hnext; // hash chain
   struct buf *qnext; // disk queue
-  uchar data[512];
+  uchar *data;       // BSIZE bytes, BSIZE-aligned, for DMA
 };
-#define B_BUSY  0x1  // buffer is locked by some process
 #define B_VALID 0x2  // buffer has been read from disk
 #define B_DIRTY 0x4  // buffer needs to be written to disk
+#define B_ASYNC 0x8  // block layer releases the buffer when done
+
+#define B_A1IN  1    // replacement queues
+#define B_AM    2
 
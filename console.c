@@ -42,7 +42,7 @@
 // } input;
 //
 // int
-// consolewrite(struct inode *ip, char *buf, int n) {
+// consolewrite(struct inode *ip, char *buf, uint off, int n) {
 //   int i;
 //
 // //  cprintf("consolewrite is called: ip=%x buf=%x, n=%x", ip, buf, n);
@@ -231,7 +231,7 @@
 // }
 //
 // int
-// consoleread(struct inode *ip, char *dst, int n)
+// consoleread(struct inode *ip, char *dst, uint off, int n)
 // {
 //   uint target;
 //   int c;
@@ -1,12 +1,23 @@
+struct blkdev;
 struct buf;
 struct context;
 struct file;
 struct inode;
+struct iostat;
+struct irqstat;
+struct irqtrace;
+struct lockstat;
 struct pipe;
 struct proc;
+struct sleeplock;
+struct pstat;
 struct spinlock;
 struct stat;
 struct superblock;
+struct sysstat;
+struct traceent;
+struct trapframe;
+struct vdso;
 
 void OkLoop(void);
 void NotOkLoop(void);
@@ -16,6 +27,7 @@ void mmuinit1(void);
 void barriers(void);
 void dsb_barrier(void);
 void flush_tlb(void);
+void flush_tlb_all(void);
 void flush_dcache_all(void);
 void flush_dcache(uint va1, uint va2);
 void flush_idcache(void);
@@ -23,9 +35,25 @@ void set_pgtbase(uint base);
 
 // bio.c
 void            binit(void);
+struct buf*     bget(uint, uint);
 struct buf*     bread(uint, uint);
+void            breadn(uint, uint, int, struct buf**);
+void            breadahead(uint, uint);
 void            brelse(struct buf*);
+void            bput(struct buf*);
 void            bwrite(struct buf*);
+void            bawrite(struct buf*);
+void            bwriten(struct buf**, int);
+void            bstat(struct iostat*);
+
+// blk.c
+void            blkregister(int, struct blkdev*);
+void            blkstart(struct buf*);
+void            blkrw(struct buf*);
+void            blkrwn(struct buf**, int);
+void            blkdone(struct blkdev*);
+void            blkstat(struct iostat*);
+void            diskinit(void);
 
 // console.c
 // void            consoleinit(void);
@@ -39,7 +67,7 @@ void            bwrite(struct buf*);
 
 // uart_keyboard.c
 void uartkbdintr(int (*getc)(void));
-int uartkbdread(struct inode *ip, char *dst, int n);
+int uartkbdread(struct inode *ip, char *dst, uint off, int n);
 void uartkbdinit(void);
 
 // framebuffer.c
@@ -76,10 +104,15 @@ void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
 
-// ide.c
+// memide.c
 void            ideinit(void);
-void            ideintr(void);
-void            iderw(struct buf*);
+
+// emmc.c
+void            sdinit(void);
+
+// ramdisk.c
+uint            rdinit(void);
+int             rdsync(void);
 
 // exec.c
 int             exec(char*, char**);
@@ -113,11 +146,25 @@ int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
+// irq.c
+void            handle_irq(void);
+uint            irqcount(int);
+int             irqstatcopy(struct irqstat*, int);
+void            irq_register(int, void(*)(void*), void*);
+
+// irqtrace.c
+void            irqtracecopy(struct irqtrace*, int);
+void            traceclistart(void*);
+void            tracecliend(void);
+void            traceirqentry(void);
+void            traceirqexit(void);
+
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+int             kfreepages(void);
 
 
 // log.c
@@ -125,6 +172,7 @@ void            initlog(void);
 void            log_write(struct buf*);
 void            begin_trans();
 void            commit_trans();
+void            logflush(void);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
@@ -134,19 +182,29 @@ int             pipewrite(struct pipe*, char*, int);
 
 //PAGEBREAK: 16
 // proc.c
+int             clone(uint, uint, uint);
 struct proc*    copyproc(struct proc*);
 void            exit(void);
 int             fork(void);
+int             futexwait(uint, uint);
+int             futexwake(uint, int);
+int             getprocs(struct pstat*, int);
 int             growproc(int);
+int             join(void);
 int             kill(int);
+void            killthreads(void);
+struct proc*    kthread(char*, void(*)(void));
+struct proc*    myproc(void);
 void            pinit(void);
 void            procdump(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
+int             settrace(int, uint, uint);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeproc(struct proc*, void*);
 void            yield(void);
 
 
@@ -160,6 +218,9 @@ int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
 void            syscall(void);
+void            syscallinit(void);
+int             sysstatcopy(struct sysstat*, int);
+int             traceread(struct traceent*, int);
 
 void kvmalloc(void);
 
@@ -171,11 +232,25 @@ uint KeyboardCount(void);
 uint KeyboardGetAddress(uint);
 struct KeyboardLeds KeyboardGetLedSupport(uint);
 
+// sleeplock.c
+void            acquiresleep(struct sleeplock*);
+void            releasesleep(struct sleeplock*);
+int             holdingsleep(struct sleeplock*);
+void            initsleeplock(struct sleeplock*, char*);
+
+// softirq.c
+void            do_softirq(void);
+void            raise_softirq(int);
+void            softirq_register(int, void(*)(void));
+void            softirqinit(void);
+void            softirqstart(void);
+
 // spinlock.c
 void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+int             lockstats(struct lockstat*, int);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
@@ -200,12 +275,16 @@ void            syscall(void);
 
 // timer.c
 void		timer3init(void);
-void		timer3intr(void);
+void		timer3intr(void*);
+void		localtimerinit(void);
+int		localtimerintr(void);
 unsigned long long getsystemtime(void);
+uint		getsystemtimelo(void);
 void		delay(uint);
 
 // trap.c
 void            tvinit(void);
+void            modestackinit(void);
 void		sti(void);
 void		cli(void);
 void 		disable_intrs(void);
@@ -216,11 +295,19 @@ uint		readcpsr(void);
 
 // uart.c
 void            uartinit(void);
-void            miniuartintr(void);
+void            miniuartintr(void*);
 void            uartputc(uint);
 void		setgpiofunc(uint, uint);
 void		setgpioval(uint, uint);
 
+// vfp.c
+void            vfpflush(struct proc*);
+void            vfpforget(struct proc*);
+void            vfpinit(void);
+void            vfpswitchin(struct proc*);
+void            vfpswitchout(struct proc*);
+int             vfptrap(struct trapframe*);
+
 // vm.c
 void            seginit(void);
 void            kvmalloc(void);
@@ -238,6 +325,8 @@ void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 int             copyin(pde_t *, void *, uint, uint );
 void            clearpteu(pde_t *pgdir, char *uva);
+extern struct vdso *vdso;
+void            vdsoinit(void);
 
 // mailbox.c
 uint readmailbox(u8);
@@ -245,6 +334,12 @@ void writemailbox(uint *, u8);
 void create_request(volatile uint *mbuf, uint tag, uint buflen, uint len, uint *data);
 void mailboxinit(void);
 
+// mp.c
+extern int      ncpu;
+int             cpunum(void);
+void            startothers(void);
+void            releaseothers(void);
+
 
 
 // number of elements in fixed-size array
@@ -0,0 +1,439 @@
+// Driver for the BCM2835 EMMC controller (an Arasan SDHCI) and
+// the SD card in its slot, for the block layer (blk.c).
+//
+// sdinit() brings the card up by polling, with interrupts off.
+// After that every transfer is one READ/WRITE_MULTIPLE_BLOCK
+// command (SINGLE for one sector) whose data a BCM2835 DMA
+// channel moves between the controller's DATA register and the
+// buffers, one control block per buffer, paced by the EMMC's
+// DREQ.  The controller's "data done" interrupt ends it.
+//
+// The controller advertises neither SDMA nor ADMA, on the Pi or
+// in QEMU, so the system DMA engine does the copying.  Under
+// QEMU, attach a raw image with -drive if=sd,format=raw,file=...
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "fs.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "traps.h"
+#include "arm.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "buf.h"
+#include "blk.h"
+#include "mailbox.h"
+
+extern volatile uint *mailbuffer;
+
+#define EMMC_BASE	(DEVSPACE+0x300000)
+#define EMMC_BLKSIZECNT	(EMMC_BASE+0x04)
+#define EMMC_ARG1	(EMMC_BASE+0x08)
+#define EMMC_CMDTM	(EMMC_BASE+0x0C)
+#define EMMC_RESP0	(EMMC_BASE+0x10)
+#define EMMC_RESP1	(EMMC_BASE+0x14)
+#define EMMC_RESP2	(EMMC_BASE+0x18)
+#define EMMC_RESP3	(EMMC_BASE+0x1C)
+#define EMMC_STATUS	(EMMC_BASE+0x24)
+#define EMMC_CONTROL0	(EMMC_BASE+0x28)
+#define EMMC_CONTROL1	(EMMC_BASE+0x2C)
+#define EMMC_INTERRUPT	(EMMC_BASE+0x30)
+#define EMMC_IRPT_MASK	(EMMC_BASE+0x34)
+#define EMMC_IRPT_EN	(EMMC_BASE+0x38)
+#define EMMC_CONTROL2	(EMMC_BASE+0x3C)
+#define EMMC_DATA_BUS	(BUSIO+0x300020)	// DATA, for the DMA engine
+
+#define SR_CMD_INHIBIT	(1 << 0)
+#define SR_DAT_INHIBIT	(1 << 1)
+
+#define C0_DWIDTH4	(1 << 1)
+#define C0_POWER	(0xF << 8)	// 3.3V, bus power on
+#define C1_CLK_INTLEN	(1 << 0)
+#define C1_CLK_STABLE	(1 << 1)
+#define C1_CLK_EN	(1 << 2)
+#define C1_DATA_TOUNIT	(0xE << 16)
+#define C1_SRST_HC	(1 << 24)
+#define C1_SRST_CMD	(1 << 25)
+
+#define INT_CMD_DONE	(1 << 0)
+#define INT_DATA_DONE	(1 << 1)
+#define INT_ERR		(1 << 15)
+#define INT_ERRORS	0x01FF8000
+
+// CMDTM: the command index, its response and its data.
+#define CMD(n)		((n) << 24)
+#define TM_BLKCNT	(1 << 1)
+#define TM_AUTOCMD12	(1 << 2)
+#define TM_READ		(1 << 4)
+#define TM_MULTI	(1 << 5)
+#define RSP136		(1 << 16)
+#define RSP48		(2 << 16)
+#define RSP48B		(3 << 16)
+#define CRCCHK		(1 << 19)
+#define IXCHK		(1 << 20)
+#define ISDATA		(1 << 21)
+
+#define R1		(RSP48|CRCCHK|IXCHK)
+#define R1B		(RSP48B|CRCCHK|IXCHK)
+#define R2		(RSP136|CRCCHK)
+#define R3		RSP48
+#define R6		R1
+#define R7		R1
+
+#define GO_IDLE_STATE	CMD(0)
+#define ALL_SEND_CID	(CMD(2)|R2)
+#define SEND_RCA	(CMD(3)|R6)
+#define SELECT_CARD	(CMD(7)|R1B)
+#define SEND_IF_COND	(CMD(8)|R7)
+#define SEND_CSD	(CMD(9)|R2)
+#define SET_BLOCKLEN	(CMD(16)|R1)
+#define READ_SINGLE	(CMD(17)|R1|ISDATA|TM_READ)
+#define READ_MULTI	(CMD(18)|R1|ISDATA|TM_READ|TM_MULTI|TM_BLKCNT|TM_AUTOCMD12)
+#define WRITE_SINGLE	(CMD(24)|R1|ISDATA)
+#define WRITE_MULTI	(CMD(25)|R1|ISDATA|TM_MULTI|TM_BLKCNT|TM_AUTOCMD12)
+#define APP_CMD		(CMD(55)|R1)
+#define SET_BUS_WIDTH	(CMD(6)|R1)	// after APP_CMD
+#define SD_SEND_OP_COND	(CMD(41)|R3)	// after APP_CMD
+
+#define OCR_BUSY	(1U << 31)	// card is ready, in fact
+#define OCR_HCS		(1 << 30)	// block addressed (SDHC)
+#define OCR_VOLTAGES	0x00FF8000
+
+// DMA channel 4 is among those the firmware leaves to the ARM.
+#define DMA_CHAN	4
+#define DMA_BASE	(DEVSPACE+0x7000+DMA_CHAN*0x100)
+#define DMA_CS		(DMA_BASE+0x00)
+#define DMA_CONBLK_AD	(DMA_BASE+0x04)
+#define DMA_ENABLE	(DEVSPACE+0x7FF0)
+
+#define CS_ACTIVE	(1 << 0)
+#define CS_END		(1 << 1)
+#define CS_ERROR	(1 << 8)
+#define CS_RESET	(1U << 31)
+
+#define TI_WAIT_RESP	(1 << 3)
+#define TI_DEST_INC	(1 << 4)
+#define TI_DEST_DREQ	(1 << 6)
+#define TI_SRC_INC	(1 << 8)
+#define TI_SRC_DREQ	(1 << 10)
+#define TI_PERMAP(n)	((n) << 16)
+#define DREQ_EMMC	11
+
+#define INITHZ		400000
+#define XFERHZ		25000000
+#define TIMEOUT		100000		// us, for a command or a reset
+
+// A DMA control block; the engine wants them 32-byte aligned.
+struct dmacb {
+  uint ti;
+  uint src;
+  uint dst;
+  uint len;
+  uint stride;
+  uint next;
+  uint pad[2];
+};
+
+static struct {
+  uint base;            // the controller's clock, in Hz
+  uint rca;             // the card's relative address
+  int hc;               // SDHC: addressed by sector, not byte
+  struct dmacb *cb;     // a page of control blocks
+  struct buf *xfer;     // the transfer in progress
+} sd;
+
+static int sdstart(struct blkdev*, struct buf*, int);
+
+static struct blkdev sddev = {
+  .name = "sd",
+  .start = sdstart,
+  .maxmerge = 32,
+};
+
+// RAM as the DMA engine addresses it.
+static uint
+busaddr(void *p)
+{
+  return VCBUS | v2p(p);
+}
+
+static void
+usdelay(uint us)
+{
+  uint t0;
+
+  t0 = getsystemtimelo();
+  while(getsystemtimelo() - t0 < us)
+    ;
+}
+
+// Wait until the bits in mask of register reg equal want.
+static int
+waitreg(uint reg, uint mask, uint want)
+{
+  uint t0;
+
+  t0 = getsystemtimelo();
+  while((inw(reg) & mask) != want)
+    if(getsystemtimelo() - t0 > TIMEOUT)
+      return -1;
+  return 0;
+}
+
+// Wait for one of the interrupts in mask.  Return -1 on an
+// error or a timeout, after resetting the command line.
+static int
+waitirpt(uint mask)
+{
+  uint t0, irpt;
+
+  t0 = getsystemtimelo();
+  while(((irpt = inw(EMMC_INTERRUPT)) & (mask|INT_ERR)) == 0)
+    if(getsystemtimelo() - t0 > TIMEOUT)
+      break;
+  if((irpt & mask) == 0 || (irpt & INT_ERR)){
+    outw(EMMC_CONTROL1, inw(EMMC_CONTROL1) | C1_SRST_CMD);
+    waitreg(EMMC_CONTROL1, C1_SRST_CMD, 0);
+    outw(EMMC_INTERRUPT, ~0);
+    return -1;
+  }
+  outw(EMMC_INTERRUPT, irpt & mask);
+  return 0;
+}
+
+// Send a command and wait for its response.
+static int
+sdcmd(uint cmd, uint arg)
+{
+  if(waitreg(EMMC_STATUS, SR_CMD_INHIBIT, 0) < 0)
+    return -1;
+  outw(EMMC_INTERRUPT, ~0);
+  outw(EMMC_ARG1, arg);
+  outw(EMMC_CMDTM, cmd);
+  if(waitirpt(INT_CMD_DONE) < 0)
+    return -1;
+  if((cmd & RSP48B) == RSP48B && (cmd & ISDATA) == 0)
+    return waitirpt(INT_DATA_DONE);
+  return 0;
+}
+
+static int
+sdappcmd(uint cmd, uint arg)
+{
+  if(sdcmd(APP_CMD, sd.rca << 16) < 0)
+    return -1;
+  return sdcmd(cmd, arg);
+}
+
+// Run the card clock at hz or a little below.
+static int
+sdclock(uint hz)
+{
+  uint div10, c1;
+
+  // The clock is base/(2*div10), div10 of 10 bits.
+  div10 = div(sd.base + 2*hz - 1, 2*hz);
+  if(div10 > 0x3FF)
+    div10 = 0x3FF;
+  if(waitreg(EMMC_STATUS, SR_CMD_INHIBIT|SR_DAT_INHIBIT, 0) < 0)
+    return -1;
+  c1 = inw(EMMC_CONTROL1) & ~C1_CLK_EN;
+  outw(EMMC_CONTROL1, c1);
+  usdelay(10);
+  c1 = (c1 & ~0xFFC0) | (div10 & 0xFF) << 8 | (div10 >> 8) << 6;
+  outw(EMMC_CONTROL1, c1 | C1_CLK_INTLEN | C1_DATA_TOUNIT);
+  if(waitreg(EMMC_CONTROL1, C1_CLK_STABLE, C1_CLK_STABLE) < 0)
+    return -1;
+  outw(EMMC_CONTROL1, inw(EMMC_CONTROL1) | C1_CLK_EN);
+  usdelay(10);
+  return 0;
+}
+
+// The controller's clock, from the firmware.
+static uint
+sdbaseclock(void)
+{
+  uint data[2];
+
+  data[0] = 1;  // the EMMC clock
+  data[1] = 0;
+  create_request(mailbuffer, MPI_TAG_GET_CLOCK_RATE, 8, 4, data);
+  writemailbox((uint *)mailbuffer, 8);
+  readmailbox(8);
+  if(mailbuffer[POS_RV] != MPI_RESPONSE_OK ||
+     mailbuffer[MB_HEADER_LENGTH + TAG_HEADER_LENGTH + 1] == 0)
+    return 250000000;  // the firmware's usual setting
+  return mailbuffer[MB_HEADER_LENGTH + TAG_HEADER_LENGTH + 1];
+}
+
+// The card's size in sectors, from its CSD.  The controller
+// drops the CSD's CRC byte, so CSD bit n is response bit n-8.
+static uint
+sdsize(void)
+{
+  uint r1, r2, csize, mult, bllen;
+
+  r1 = inw(EMMC_RESP1);
+  r2 = inw(EMMC_RESP2);
+  if(((inw(EMMC_RESP3) >> 22) & 3) == 1){
+    // CSD version 2: C_SIZE in 512KB units.
+    csize = (r1 >> 8) & 0x3FFFFF;
+    return (csize + 1) << 10;
+  }
+  csize = (r2 & 3) << 10 | r1 >> 22;
+  mult = (r1 >> 7) & 7;
+  bllen = (r2 >> 8) & 0xF;
+  return (csize + 1) << (mult + 2 + bllen - 9);
+}
+
+// Reset the controller and bring the card to the transfer
+// state.  Return -1 if there is no usable card.
+static int
+sdcardinit(void)
+{
+  uint ocr, v2;
+  int i;
+
+  outw(EMMC_CONTROL0, 0);
+  outw(EMMC_CONTROL1, C1_SRST_HC);
+  if(waitreg(EMMC_CONTROL1, C1_SRST_HC, 0) < 0)
+    return -1;
+  outw(EMMC_CONTROL2, 0);
+  outw(EMMC_CONTROL0, C0_POWER);
+  sd.base = sdbaseclock();
+  if(sdclock(INITHZ) < 0)
+    return -1;
+  outw(EMMC_IRPT_EN, 0);
+  outw(EMMC_INTERRUPT, ~0);
+  outw(EMMC_IRPT_MASK, ~0);
+
+  sd.rca = 0;
+  if(sdcmd(GO_IDLE_STATE, 0) < 0)
+    return -1;
+  // Version 2 cards echo the check pattern; older ones time out.
+  v2 = sdcmd(SEND_IF_COND, 0x1AA) == 0 && (inw(EMMC_RESP0) & 0xFFF) == 0x1AA;
+  for(i = 0; ; i++){
+    if(i == 100 || sdappcmd(SD_SEND_OP_COND, OCR_VOLTAGES | (v2 ? OCR_HCS : 0)) < 0)
+      return -1;
+    if((ocr = inw(EMMC_RESP0)) & OCR_BUSY)
+      break;
+    usdelay(10000);
+  }
+  sd.hc = (ocr & OCR_HCS) != 0;
+
+  if(sdcmd(ALL_SEND_CID, 0) < 0 || sdcmd(SEND_RCA, 0) < 0)
+    return -1;
+  sd.rca = inw(EMMC_RESP0) >> 16;
+  if(sdcmd(SEND_CSD, sd.rca << 16) < 0)
+    return -1;
+  sddev.size = sdsize();
+  if(sdcmd(SELECT_CARD, sd.rca << 16) < 0 ||
+     sdappcmd(SET_BUS_WIDTH, 2) < 0)
+    return -1;
+  outw(EMMC_CONTROL0, inw(EMMC_CONTROL0) | C0_DWIDTH4);
+  if(sdcmd(SET_BLOCKLEN, SECTSIZE) < 0)
+    return -1;
+  return sdclock(XFERHZ);
+}
+
+// Start the n-block transfer beginning with b: the command,
+// then the DMA, which the controller paces.
+static int
+sdstart(struct blkdev *d, struct buf *b, int n)
+{
+  struct dmacb *cb;
+  struct buf *p;
+  uint cmd, sector;
+  int write;
+
+  write = b->flags & B_DIRTY;
+  cb = sd.cb;
+  for(p = b; p; p = p->qnext, cb++){
+    if((p->blockno + 1) * (BSIZE/SECTSIZE) > d->size)
+      panic("sd: block out of range");
+    // Write back the data for the engine to read, or make sure
+    // no dirty line lands on what it writes.
+    flush_dcache((uint)p->data, (uint)p->data + BSIZE - 1);
+    if(write){
+      cb->ti = TI_SRC_INC | TI_DEST_DREQ;
+      cb->src = busaddr(p->data);
+      cb->dst = EMMC_DATA_BUS;
+    } else {
+      cb->ti = TI_SRC_DREQ | TI_DEST_INC;
+      cb->src = EMMC_DATA_BUS;
+      cb->dst = busaddr(p->data);
+    }
+    cb->ti |= TI_WAIT_RESP | TI_PERMAP(DREQ_EMMC);
+    cb->len = BSIZE;
+    cb->stride = 0;
+    cb->next = p->qnext ? busaddr(cb+1) : 0;
+  }
+  flush_dcache((uint)sd.cb, (uint)cb - 1);
+
+  n *= BSIZE/SECTSIZE;
+  if(n > 1)
+    cmd = write ? WRITE_MULTI : READ_MULTI;
+  else
+    cmd = write ? WRITE_SINGLE : READ_SINGLE;
+  if(waitreg(EMMC_STATUS, SR_DAT_INHIBIT, 0) < 0)
+    panic("sd: busy");
+  sector = b->blockno * (BSIZE/SECTSIZE);
+  outw(EMMC_BLKSIZECNT, n << 16 | SECTSIZE);
+  if(sdcmd(cmd, sd.hc ? sector : sector * SECTSIZE) < 0)
+    panic("sd: command failed");
+
+  sd.xfer = b;
+  outw(EMMC_IRPT_EN, INT_DATA_DONE | INT_ERRORS);
+  outw(DMA_CONBLK_AD, busaddr(sd.cb));
+  outw(DMA_CS, CS_ACTIVE);
+  return 0;
+}
+
+static void
+sdintr(void *arg)
+{
+  struct buf *p;
+  uint irpt;
+
+  irpt = inw(EMMC_INTERRUPT);
+  outw(EMMC_INTERRUPT, irpt);
+  if(irpt & INT_ERR)
+    panic("sd: transfer error");
+  if((irpt & INT_DATA_DONE) == 0 || sd.xfer == 0)
+    return;
+  outw(EMMC_IRPT_EN, 0);
+
+  // The engine may still be writing the last words it read.
+  while(inw(DMA_CS) & CS_ACTIVE)
+    ;
+  if(inw(DMA_CS) & CS_ERROR)
+    panic("sd: dma error");
+  outw(DMA_CS, CS_END);
+  for(p = sd.xfer; p; p = p->qnext)
+    if((p->flags & B_DIRTY) == 0)
+      flush_dcache((uint)p->data, (uint)p->data + BSIZE - 1);
+  sd.xfer = 0;
+  blkdone(&sddev);
+}
+
+void
+sdinit(void)
+{
+  if((sd.cb = (struct dmacb*)kalloc()) == 0)
+    panic("sdinit");
+  if(sdcardinit() < 0){
+    if(SDDEV == ROOTDEV)
+      panic("sd: no root card");
+    cprintf("sd: no card\n");
+    kfree((char*)sd.cb);
+    return;
+  }
+  outw(DMA_ENABLE, inw(DMA_ENABLE) | (1 << DMA_CHAN));
+  outw(DMA_CS, CS_RESET);
+  usdelay(10);
+  cprintf("sd: %d sectors%s\n", sddev.size, sd.hc ? ", SDHC" : "");
+  irq_register(IRQ_EMMC, sdintr, 0);
+  blkregister(SDDEV, &sddev);
+}
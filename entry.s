@@ -13,13 +13,23 @@ _start:
 b entry  /* branch to the actual entry code */
 
 entry:
+bl tosvc
 
-/* interrupts disabled, SVC mode by setting PSR_DISABLE_IRQ|PSR_DISABLE_FIQ|PSR_MODE_SVC */
-mov r1, #0x00000080 /* PSR_DISABLE_IRQ */
-orr r1, #0x00000040 /* PSR_DISABLE_FIQ */
-orr r1, #0x00000013 /* PSR_MODE_SVC */
-msr cpsr, r1
+/* On a BCM2836 every core may start here (QEMU does this, the
+ * firmware parks the others itself).  Only core 0 boots; the rest
+ * wait in park for startothers().  The ARM1176 has no MPIDR, so
+ * check the part number in MIDR first. */
+mrc p15, 0, r0, c0, c0, 0 /* MIDR */
+ldr r2, =0x0000FFF0
+and r0, r0, r2
+ldr r2, =0x0000B760 /* ARM1176 */
+cmp r0, r2
+beq primary
+mrc p15, 0, r0, c0, c0, 5 /* MPIDR */
+ands r0, r0, #3
+bne park
 
+primary:
 mov sp, #0x3000 
 bl mmuinit0
 
@@ -37,6 +47,56 @@ mov r0, sp
 bl cmain  /* call C functions now */
 bl NotOkLoop
 
+/* Return to lr in SVC mode with interrupts disabled.  A Cortex-A7
+ * may be started in HYP mode, which can only be left by an
+ * exception return; the ARM1176 has no HYP mode. */
+tosvc:
+mrs r0, cpsr
+and r0, r0, #0x0000001F /* PSR_MASK */
+cmp r0, #0x0000001A /* HYP mode */
+bne 1f
+.word 0xE12EF30E /* msr elr_hyp, lr */
+mov r1, #0x000000D3
+msr spsr_cxsf, r1
+.word 0xE160006E /* eret */
+1:
+/* interrupts disabled, SVC mode by setting PSR_DISABLE_IRQ|PSR_DISABLE_FIQ|PSR_MODE_SVC */
+mov r1, #0x00000080 /* PSR_DISABLE_IRQ */
+orr r1, #0x00000040 /* PSR_DISABLE_FIQ */
+orr r1, #0x00000013 /* PSR_MODE_SVC */
+msr cpsr, r1
+bx lr
+
+/* Secondary cores spin here with the MMU off until startothers()
+ * writes an entry point into this core's mailbox 3 (r0 = core). */
+park:
+ldr r1, =0x400000CC /* core 0 mailbox 3 read/clear */
+add r1, r1, r0, lsl #4
+1:
+wfe
+ldr r2, [r1]
+cmp r2, #0
+beq 1b
+str r2, [r1]
+bx r2
+
+/* Entry point of a secondary core, at its physical address: enable
+ * the MMU on the boot stack left in mpstack and enter mpmain(). */
+.global mpentry
+mpentry:
+bl tosvc
+ldr sp, mpstack
+bl mmuinitap
+mov r1, sp
+add r1, #0x80000000
+mov sp, r1
+ldr r1, =mpmain
+bx r1
+
+.global mpstack
+mpstack:
+.word 0
+
 .global dsb_barrier
 dsb_barrier:
 	mov r0, #0
@@ -66,7 +126,15 @@ flush_tlb:
 	bx lr
 .global flush_dcache /* flush a range of data cache flush_dcache(va1, va2) */
 flush_dcache:
-	mcrr p15, 0, r0, r1, c14
+	/* line by line: the ARM1176 range operation is gone in ARMv7 */
+	bic r0, r0, #31 /* CACHELINESIZE-1 */
+1:
+	mcr p15, 0, r0, c7, c14, 1 /* clean and invalidate line */
+	add r0, r0, #32
+	cmp r0, r1
+	bls 1b
+	mov r0, #0
+	mcr p15, 0, r0, c7, c10, 4 /* dsb */
 	bx lr
 .global set_pgtbase /* set the page table base set_pgtbase(base) */
 set_pgtbase:
@@ -10,6 +10,7 @@
 int
 exec(char *path, char **argv)
 {
+  struct proc *curproc = curr_proc;
   char *last;
   int i, off;
   uint argc, sz, sp, ustack[3+MAXARG+1];
@@ -18,6 +19,10 @@ exec(char *path, char **argv)
   struct proghdr ph;
   pde_t *pgdir, *oldpgdir;
 
+  // Only the group leader may replace the shared address space.
+  if(curproc->isthread)
+    return -1;
+
   if((ip = namei(path)) == 0)
     return -1;
   ilock(ip);
@@ -81,17 +86,20 @@ exec(char *path, char **argv)
     if(*s == '/')
       last = s+1;*/
   last = argv[0];
-  safestrcpy(curr_proc->name, last, sizeof(curr_proc->name));
+  safestrcpy(curproc->name, last, sizeof(curproc->name));
 
   // Commit to the user image.
-  oldpgdir = curr_proc->pgdir;
-  curr_proc->pgdir = pgdir;
-  curr_proc->sz = sz;
-  curr_proc->tf->pc = elf.entry;  // main
-  curr_proc->tf->sp = sp;
-  curr_proc->tf->r0 = ustack[1];
-  curr_proc->tf->r1 = ustack[2];
-  switchuvm(curr_proc);
+  // The other threads go away with the old image.
+  killthreads();
+  vfpforget(curproc);
+  oldpgdir = curproc->pgdir;
+  curproc->pgdir = pgdir;
+  curproc->sz = sz;
+  curproc->tf->pc = elf.entry;  // main
+  curproc->tf->sp = sp;
+  curproc->tf->r0 = ustack[1];
+  curproc->tf->r1 = ustack[2];
+  switchuvm(curproc);
   freevm(oldpgdir);
   return 0;
 
@@ -14,7 +14,8 @@ struct inode {
   uint dev;           // Device number
   uint inum;          // Inode number
   int ref;            // Reference count
-  int flags;          // I_BUSY, I_VALID
+  struct sleeplock lock;
+  int flags;          // I_VALID
 
   short type;         // copy of disk inode
   short major;
@@ -22,15 +23,18 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+
+  uint raoff;         // readahead: where the last read ended
+  uint rawin;         // blocks to keep read ahead; 0 if not sequential
+  uint raend;         // first block not yet read ahead
 };
-#define I_BUSY 0x1
 #define I_VALID 0x2
 
 // table mapping major device number to
 // device functions
 struct devsw {
-  int (*read)(struct inode*, char*, int);
-  int (*write)(struct inode*, char*, int);
+  int (*read)(struct inode*, char*, uint, int);
+  int (*write)(struct inode*, char*, uint, int);
 };
 
 extern struct devsw devsw[];
@@ -38,4 +42,5 @@ extern struct devsw devsw[];
 #define CONSOLE 1
 #define UART_KEYBOARD 2
 #define FRAMEBUFFER 3
+#define DISK 4          // raw block device; minor is the device
 
@@ -11,12 +11,13 @@
 #include "param.h"
 #include "traps.h"
 #include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
 #include "file.h"
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
 #include "arm.h"
-#include "spinlock.h"
 
 uint frameheight=768, framewidth=1024, framecolors=16;
 FBI fbinfo __attribute__ ((aligned (16), nocommon));
@@ -132,6 +133,10 @@ void framebufferinit(void)
 
   fbinfoaddr = initframebuf(framewidth, frameheight, framecolors);
   if(fbinfoaddr != 0) NotOkLoop();
+#ifdef RPI2
+  // a bus address; mmuinit0 maps all of ram at GPUMEMBASE
+  fbinfo.fbp = GPUMEMBASE + (fbinfo.fbp & 0x3FFFFFFF);
+#endif
 
 }
 
@@ -143,7 +148,7 @@ panic(char *s)
     int i;
     uint pcs[10];
 
-    cprintf("cpu%d: panic: ", 0);
+    cprintf("cpu%d: panic: ", curr_cpu->id);
     cprintf(s);
     cprintf("\n");
     getcallerpcs(&s, pcs);
@@ -308,7 +313,7 @@ void fb_fillrect(int x, int y, int w, int h, u16 color) {
 }
 
 int
-fbwrite(struct inode *ip, char *userbuf, int n)
+fbwrite(struct inode *ip, char *userbuf, uint fileoff, int n)
 {
     int off = 0;
     acquire(&cons.lock);
@@ -371,7 +376,7 @@ fbwrite(struct inode *ip, char *userbuf, int n)
 
 
 int
-fbread(struct inode *ip, char *userbuf, int n)
+fbread(struct inode *ip, char *userbuf, uint fileoff, int n)
 {
     // Optional: you can implement read to return framebuffer content
     // For now, let's just return 0
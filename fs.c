@@ -16,11 +16,14 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "sleeplock.h"
 #include "buf.h"
 #include "fs.h"
 #include "file.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
+#define RAMIN 4     // first readahead window, in blocks
+#define RAMAX 32    // largest readahead window
 static void itrunc(struct inode*);
 
 // Read the super block.
@@ -110,7 +113,7 @@ bfree(int dev, uint b)
 // to provide a place for synchronizing access
 // to inodes used by multiple processes. The cached
 // inodes include book-keeping information that is
-// not stored on disk: ip->ref and ip->flags.
+// not stored on disk: ip->ref, ip->lock and ip->flags.
 //
 // An inode and its in-memory represtative go through a
 // sequence of states before they can be used by the
@@ -135,9 +138,8 @@ bfree(int dev, uint b)
 //
 // * Locked: file system code may only examine and modify
 //   the information in an inode and its content if it
-//   has first locked the inode. The I_BUSY flag indicates
-//   that the inode is locked. ilock() sets I_BUSY,
-//   while iunlock clears it.
+//   has first locked the inode. ilock() acquires the
+//   sleep lock ip->lock, while iunlock releases it.
 //
 // Thus a typical sequence is:
 //   ip = iget(dev, inum)
@@ -165,8 +167,12 @@ struct {
 void
 iinit(void)
 {
+  int i;
+
   memset(&icache, 0, sizeof(icache));
   initlock(&icache.lock, "icache");
+  for(i = 0; i < NINODE; i++)
+    initsleeplock(&icache.inode[i].lock, "inode");
 }
 
 static struct inode* iget(uint dev, uint inum);
@@ -250,6 +256,9 @@ iget(uint dev, uint inum)
   ip->inum = inum;
   ip->ref = 1;
   ip->flags = 0;
+  ip->raoff = 0;
+  ip->rawin = 0;
+  ip->raend = 0;
   release(&icache.lock);
 
   return ip;
@@ -277,11 +286,7 @@ ilock(struct inode *ip)
   if(ip == 0 || ip->ref < 1)
     panic("ilock");
 
-  acquire(&icache.lock);
-  while(ip->flags & I_BUSY)
-    sleep(ip, &icache.lock);
-  ip->flags |= I_BUSY;
-  release(&icache.lock);
+  acquiresleep(&ip->lock);
 
   if(!(ip->flags & I_VALID)){
     bp = bread(ip->dev, IBLOCK(ip->inum));
@@ -303,13 +308,10 @@ ilock(struct inode *ip)
 void
 iunlock(struct inode *ip)
 {
-  if(ip == 0 || !(ip->flags & I_BUSY) || ip->ref < 1)
+  if(ip == 0 || !holdingsleep(&ip->lock) || ip->ref < 1)
     panic("iunlock");
 
-  acquire(&icache.lock);
-  ip->flags &= ~I_BUSY;
-  wakeup(ip);
-  release(&icache.lock);
+  releasesleep(&ip->lock);
 }
 
 // Drop a reference to an in-memory inode.
@@ -323,16 +325,16 @@ iput(struct inode *ip)
   acquire(&icache.lock);
   if(ip->ref == 1 && (ip->flags & I_VALID) && ip->nlink == 0){
     // inode has no links: truncate and free inode.
-    if(ip->flags & I_BUSY)
+    if(ip->lock.locked)
       panic("iput busy");
-    ip->flags |= I_BUSY;
     release(&icache.lock);
+    acquiresleep(&ip->lock);
     itrunc(ip);
     ip->type = 0;
     iupdate(ip);
-    acquire(&icache.lock);
     ip->flags = 0;
-    wakeup(ip);
+    releasesleep(&ip->lock);
+    acquire(&icache.lock);
   }
   ip->ref--;
   release(&icache.lock);
@@ -419,6 +421,7 @@ itrunc(struct inode *ip)
   }
 
   ip->size = 0;
+  ip->raend = 0;
   iupdate(ip);
 }
 
@@ -433,19 +436,74 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+// Sequential readahead.  ip has just been read from off to off+n.
+// If that continued the previous read (or started the file), read
+// the blocks after it into the cache before they are asked for,
+// keeping a window ahead that doubles with every sequential read
+// up to RAMAX blocks.  Caller must hold ip->lock.
+static void
+readahead(struct inode *ip, uint off, uint n)
+{
+  uint bn, end, nblocks;
+
+  if(off == 0 && ip->raoff != 0){
+    // A new pass from the start: open the window afresh.
+    ip->rawin = 0;
+    ip->raend = 0;
+  } else if(off != ip->raoff){
+    ip->raoff = off + n;
+    ip->rawin = 0;
+    ip->raend = 0;
+    return;
+  }
+  ip->raoff = off + n;
+  if(ip->rawin == 0)
+    ip->rawin = RAMIN;
+  else if(ip->rawin < RAMAX)
+    ip->rawin *= 2;
+
+  bn = (off + n - 1)/BSIZE + 1;
+  end = bn + ip->rawin;
+  nblocks = (ip->size + BSIZE - 1)/BSIZE;
+  if(end > nblocks)
+    end = nblocks;
+  if(bn < ip->raend)
+    bn = ip->raend;
+  for(; bn < end; bn++)
+    breadahead(ip->dev, bmap(ip, bn));
+  if(end > ip->raend)
+    ip->raend = end;
+}
+
+// Map file blocks bn to last, at most MAXRUN of them, to disk
+// sectors.  Return how many from bn on lie in one run on disk,
+// starting at *sector.
+static int
+bmaprun(struct inode *ip, uint bn, uint last, uint *sector)
+{
+  int n;
+
+  *sector = bmap(ip, bn);
+  for(n = 1; n < MAXRUN && bn + n <= last; n++)
+    if(bmap(ip, bn + n) != *sector + n)
+      break;
+  return n;
+}
+
 //PAGEBREAK!
 // Read data from inode.
 int
 readi(struct inode *ip, char *dst, uint off, uint n)
 {
-  uint tot, m;
-  struct buf *bp;
+  uint tot, m, off0, last, sector;
+  struct buf *bp[MAXRUN];
+  int i, nb;
 
   if(ip->type == T_DEV){
     if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].read)
       return -1;
 //cprintf("inside readi\n");
-    return devsw[ip->major].read(ip, dst, n);
+    return devsw[ip->major].read(ip, dst, off, n);
   }
 
   if(off > ip->size || off + n < off)
@@ -453,12 +511,19 @@ readi(struct inode *ip, char *dst, uint off, uint n)
   if(off + n > ip->size)
     n = ip->size - off;
 
-  for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
-    m = min(n - tot, BSIZE - off%BSIZE);
-    memmove(dst, bp->data + off%BSIZE, m);
-    brelse(bp);
+  off0 = off;
+  last = (off + n - 1)/BSIZE;
+  for(tot=0; tot<n; ){
+    nb = bmaprun(ip, off/BSIZE, last, &sector);
+    breadn(ip->dev, sector, nb, bp);
+    for(i = 0; i < nb; i++, tot+=m, off+=m, dst+=m){
+      m = min(n - tot, BSIZE - off%BSIZE);
+      memmove(dst, bp[i]->data + off%BSIZE, m);
+      brelse(bp[i]);
+    }
   }
+  if(n > 0)
+    readahead(ip, off0, n);
   return n;
 }
 
@@ -467,14 +532,15 @@ readi(struct inode *ip, char *dst, uint off, uint n)
 int
 writei(struct inode *ip, char *src, uint off, uint n)
 {
-  uint tot, m;
-  struct buf *bp;
+  uint tot, m, last, sector;
+  struct buf *bp[MAXRUN];
+  int i, nb;
 //cprintf("inside writei: type=%x major=%x, func addr: %x\n", ip->type, ip->major, devsw[ip->major].write);
   if(ip->type == T_DEV){
     if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].write)
       return -1;
 //cprintf("before calling consolewrite: major=%x, func addr: %x\n", ip->major, devsw[ip->major].write);
-    return devsw[ip->major].write(ip, src, n);
+    return devsw[ip->major].write(ip, src, off, n);
   }
 
   if(off > ip->size || off + n < off)
@@ -482,12 +548,16 @@ writei(struct inode *ip, char *src, uint off, uint n)
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
-  for(tot=0; tot<n; tot+=m, off+=m, src+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
-    m = min(n - tot, BSIZE - off%BSIZE);
-    memmove(bp->data + off%BSIZE, src, m);
-    log_write(bp);
-    brelse(bp);
+  last = (off + n - 1)/BSIZE;
+  for(tot=0; tot<n; ){
+    nb = bmaprun(ip, off/BSIZE, last, &sector);
+    breadn(ip->dev, sector, nb, bp);
+    for(i = 0; i < nb; i++, tot+=m, off+=m, src+=m){
+      m = min(n - tot, BSIZE - off%BSIZE);
+      memmove(bp[i]->data + off%BSIZE, src, m);
+      log_write(bp[i]);
+      brelse(bp[i]);
+    }
   }
 
   if(n > 0 && off > ip->size){
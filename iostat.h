@@ -0,0 +1,27 @@
+// Buffer cache and block device statistics returned by the
+// iostat() system call.  Both the kernel and user programs use
+// this header file.
+
+#define NBLKDEV 4     // block device numbers
+
+// One block device; size is 0 if there is none.
+struct iodev {
+  char name[8];
+  uint size;          // SECTSIZE sectors
+  uint reads;         // read transfers started
+  uint writes;        // write transfers started
+  uint rblocks;       // blocks read
+  uint wblocks;       // blocks written
+  uint busyus;        // microseconds with a transfer active
+  uint waitus;        // microseconds processes waited for transfers
+};
+
+struct iostat {
+  uint bsize;         // bytes in a block
+  uint nbuf;          // buffers in the cache
+  uint hits;          // lookups that found the block cached
+  uint misses;        // lookups that had to recycle a buffer
+  uint readahead;     // blocks read ahead
+  uint lockus;        // microseconds waiting for busy buffers
+  struct iodev dev[NBLKDEV];
+};
@@ -0,0 +1,113 @@
+// Interrupt dispatch for the BCM2835 interrupt controller.
+//
+// Drivers call irq_register() to attach a handler to an
+// interrupt line, which also enables the line.  handle_irq()
+// reads each pending register once per pass and finds the set
+// bits with clz, so its cost depends on the interrupts that are
+// actually pending, not on how many drivers are registered.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "traps.h"
+#include "arm.h"
+#include "irqstat.h"
+
+static struct {
+  void (*handler)(void*);
+  void *arg;
+} irqs[NIRQ];
+
+// Lines with a handler: gpu 0-31, gpu 32-63, arm basic.
+static uint enabled[3];
+
+// Only cpu 0 takes device interrupts, so it alone updates these.
+static struct irqstat irqstats[NIRQ];
+
+// Run handler(arg) whenever irq is raised.
+void
+irq_register(int irq, void (*handler)(void*), void *arg)
+{
+  intctrlregs *ip;
+
+  if(irq < 0 || irq >= NIRQ || irqs[irq].handler)
+    panic("irq_register");
+  irqs[irq].handler = handler;
+  irqs[irq].arg = arg;
+  irqstats[irq].registered = 1;
+  enabled[irq / 32] |= 1 << (irq % 32);
+  ip = (intctrlregs *)INT_REGS_BASE;
+  if(irq >= IRQ_ARM)
+    ip->armenable = 1 << (irq % 32);
+  else
+    ip->gpuenable[irq / 32] = 1 << (irq % 32);
+}
+
+// Run the handlers for the pending interrupts set in bits,
+// numbered from base.  t0 is when the trap was taken.
+static void
+dispatch(uint bits, int base, uint t0)
+{
+  struct irqstat *s;
+  uint start, dt;
+  int irq;
+
+  while(bits){
+    irq = 31 - clz(bits);
+    bits &= ~(1 << irq);
+    irq += base;
+    s = &irqstats[irq];
+    start = getsystemtimelo();
+    irqs[irq].handler(irqs[irq].arg);
+    dt = getsystemtimelo() - start;
+    s->count++;
+    s->time += dt;
+    if(dt > s->maxtime)
+      s->maxtime = dt;
+    if(start - t0 > s->maxlatency)
+      s->maxlatency = start - t0;
+  }
+}
+
+// Handle every pending device interrupt, on cpu 0.
+void
+handle_irq(void)
+{
+  intctrlregs *ip;
+  uint t0, p0, p1, pa;
+
+  t0 = getsystemtimelo();
+  ip = (intctrlregs *)INT_REGS_BASE;
+  for(;;){
+    // Bits 8 up of armpending summarise the gpu registers.
+    p0 = ip->gpupending[0] & enabled[0];
+    p1 = ip->gpupending[1] & enabled[1];
+    pa = ip->armpending & enabled[2];
+    if((pa | p0 | p1) == 0)
+      break;
+    dispatch(p0, 0, t0);
+    dispatch(p1, 32, t0);
+    dispatch(pa, IRQ_ARM, t0);
+  }
+}
+
+// Number of times irq's handler has run.
+uint
+irqcount(int irq)
+{
+  return irqstats[irq].count;
+}
+
+// Copy the statistics of the first n interrupts to st and
+// return how many were copied.
+int
+irqstatcopy(struct irqstat *st, int n)
+{
+  if(n > NIRQ)
+    n = NIRQ;
+  memmove(st, irqstats, n*sizeof(*st));
+  return n;
+}
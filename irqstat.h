@@ -0,0 +1,15 @@
+// Per-interrupt statistics returned by the irqstat() system
+// call.  Both the kernel and user programs use this header file.
+
+// Interrupt numbers: 0-63 are the GPU interrupts (gpupending[0]
+// and [1]), 64-71 the ARM basic interrupts (armpending bits 0-7).
+#define NIRQ     72
+#define IRQ_ARM  64
+
+struct irqstat {
+  uint count;         // times the handler ran
+  uint time;          // total us spent in the handler
+  uint maxtime;       // longest handler run, us
+  uint maxlatency;    // longest wait from trap entry to handler, us
+  int registered;     // has a handler
+};
@@ -0,0 +1,103 @@
+// Measure how long interrupts wait and how long they stay off,
+// using the 1MHz system timer.  Kernels built with IRQTRACE=1
+// call these from trap() and from pushcli/popcli; each cpu
+// keeps its own statistics, so no locks are needed.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "arm.h"
+#include "irqtrace.h"
+
+// do_irq in exception.S stores the stamp at the start of struct cpu.
+typedef char irqstamp_first[__builtin_offsetof(struct cpu, irqstamp) == 0 ? 1 : -1];
+
+static struct {
+  uint clistart;            // when interrupts went off
+  uint clipcs[10];          // who turned them off
+  struct irqtrace t[NTRACE];
+} trace[NCPU];
+
+static void
+record(int kind, uint us, uint *pcs)
+{
+  struct irqtrace *t;
+  int i;
+
+  t = &trace[curr_cpu->id].t[kind];
+  t->count++;
+  t->total += us;
+  for(i = 0; us >> i && i < NTRACEHIST-1; i++)
+    ;
+  t->hist[i]++;
+  if(us > t->max){
+    t->max = us;
+    if(pcs)
+      memmove(t->maxpc, pcs, sizeof(t->maxpc));
+  }
+}
+
+// At the start of trap() for an IRQ.
+void
+traceirqentry(void)
+{
+  record(TR_ENTRY, getsystemtimelo() - curr_cpu->irqstamp, 0);
+}
+
+// When trap() has finished handling an IRQ.
+void
+traceirqexit(void)
+{
+  record(TR_IRQ, getsystemtimelo() - curr_cpu->irqstamp, 0);
+}
+
+// pushcli has just turned interrupts off; fp is its frame.
+void
+traceclistart(void *fp)
+{
+  int id;
+
+  id = curr_cpu->id;
+  trace[id].clistart = getsystemtimelo();
+  getcallerpcs(fp, trace[id].clipcs);
+}
+
+// popcli is about to turn interrupts back on.
+void
+tracecliend(void)
+{
+  int id;
+
+  id = curr_cpu->id;
+  record(TR_CLI, getsystemtimelo() - trace[id].clistart, trace[id].clipcs);
+}
+
+// Copy the statistics, combined over cpus, to t[NTRACE]; the
+// max call stack is that of the cpu with the longest.  Clear
+// them afterwards if reset is set.
+void
+irqtracecopy(struct irqtrace *t, int reset)
+{
+  struct irqtrace *s;
+  int cpu, k, i;
+
+  memset(t, 0, NTRACE*sizeof(*t));
+  for(cpu = 0; cpu < NCPU; cpu++){
+    for(k = 0; k < NTRACE; k++){
+      s = &trace[cpu].t[k];
+      t[k].count += s->count;
+      t[k].total += s->total;
+      for(i = 0; i < NTRACEHIST; i++)
+        t[k].hist[i] += s->hist[i];
+      if(s->max > t[k].max){
+        t[k].max = s->max;
+        memmove(t[k].maxpc, s->maxpc, sizeof(t[k].maxpc));
+      }
+      if(reset)
+        memset(s, 0, sizeof(*s));
+    }
+  }
+}
@@ -0,0 +1,19 @@
+// Interrupt latency and interrupts-off statistics returned by
+// the irqtrace() system call (kernels built with IRQTRACE=1).
+// Both the kernel and user programs use this header file.
+
+#define NTRACEHIST 16  // log2 histogram buckets of microseconds
+#define NTRACEPC   6   // call stack kept for the longest section
+
+#define TR_ENTRY 0  // IRQ exception to trap()
+#define TR_IRQ   1  // IRQ exception to the end of its handling
+#define TR_CLI   2  // outermost pushcli to popcli
+#define NTRACE   3
+
+struct irqtrace {
+  uint count;
+  uint total;              // us
+  uint max;                // us
+  uint hist[NTRACEHIST];   // bucket i: < 2^i us
+  uint maxpc[NTRACEPC];    // TR_CLI: who called pushcli for the max
+};
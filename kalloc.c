@@ -16,13 +16,15 @@ struct {
   struct spinlock lock;
   int use_lock;
   struct run *freelist;
+  int nfree;             // pages on freelist
 } kmem;
 
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
-// 2. main() calls kinit2() with the rest of the physical pages
-// after installing a full page table that maps them on all cores.
+// 2. main() calls kinit2() with the rest of the physical pages,
+// less those under a RAM disk image (ramdisk.c), after installing
+// a full page table that maps them on all cores.
 void
 kinit1(void *vstart, void *vend)
 {
@@ -69,6 +71,7 @@ kfree(char *v)
   r = (struct run*)v;
   r->next = kmem.freelist;
   kmem.freelist = r;
+  kmem.nfree++;
   if(kmem.use_lock)
     release(&kmem.lock);
 }
@@ -84,11 +87,18 @@ kalloc(void)
   if(kmem.use_lock)
     acquire(&kmem.lock);
   r = kmem.freelist;
-  if(r)
+  if(r){
     kmem.freelist = r->next;
+    kmem.nfree--;
+  }
   if(kmem.use_lock)
     release(&kmem.lock);
   return (char*)r;
 }
 
-
+// Return the number of free pages.
+int
+kfreepages(void)
+{
+  return kmem.nfree;
+}
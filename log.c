@@ -3,20 +3,29 @@
 #include "param.h"
 #include "spinlock.h"
 #include "fs.h"
+#include "sleeplock.h"
 #include "buf.h"
 
 // Simple logging. Each system call that might write the file system
 // should be surrounded with begin_trans() and commit_trans() calls.
 //
-// The log holds at most one transaction at a time. Commit forces
-// the log (with commit record) to disk, then installs the affected
-// blocks to disk, then erases the log. begin_trans() ensures that
-// only one system call can be in a transaction; others must wait.
-// 
-// Allowing only one transaction at a time means that the file
-// system code doesn't have to worry about the possibility of
-// one transaction reading a block that another one has modified,
-// for example an i-node block.
+// Only one system call can be in a transaction at a time;
+// begin_trans() makes the others wait.  Allowing only one
+// transaction at a time means that the file system code doesn't
+// have to worry about the possibility of one transaction reading a
+// block that another one has modified, for example an i-node block.
+//
+// Commits are grouped: commit_trans() ends the transaction but
+// writes nothing.  log_write() only records the sector and pins
+// the modified buffer in the cache, so a block written by many
+// transactions in a row (an i-node or bitmap block) is logged once.
+// The flusher thread commits every FLUSHTICKS ticks, or sooner when
+// the log is half full, and begin_trans() commits first when the
+// log has no room for another transaction.  A commit writes the
+// blocks to the log, then the header block (the commit point),
+// then installs the blocks at home in sector order, then erases
+// the log.  So a crash loses at most the last FLUSHTICKS of system
+// calls, but never leaves part of one on the disk.
 //
 // Read-only system calls don't need to use transactions, though
 // this means that they may observe uncommitted data. I-node and
@@ -29,7 +38,8 @@
 //   block B
 //   block C
 //   ...
-// Log appends are synchronous.
+
+#define FLUSHTICKS 100   // commit at least once a second
 
 // Contents of the header block, used for both the on-disk header block
 // and to keep track in memory of logged sector #s before commit.
@@ -49,6 +59,7 @@ struct log {
 struct log log;
 
 static void recover_from_log(void);
+static void logflusher(void);
 
 void
 initlog(void)
@@ -60,10 +71,64 @@ initlog(void)
   memset(&log, 0, sizeof(log));
   initlock(&log.lock, "log");
   readsb(ROOTDEV, &sb);
+  if (sb.bsize != BSIZE)
+    panic("initlog: file system block size is not BSIZE");
   log.start = sb.size - sb.nlog;
   log.size = sb.nlog;
   log.dev = ROOTDEV;
   recover_from_log();
+  kthread("logflush", logflusher);
+}
+
+// Copy modified blocks from the cache to the log, which is
+// contiguous, so up to MAXRUN blocks go in one write.
+static void
+write_log(void)
+{
+  struct buf *to[MAXRUN];
+  int tail, i, n;
+
+  for (tail = 0; tail < log.lh.n; tail += n) {
+    n = log.lh.n - tail;
+    if (n > MAXRUN)
+      n = MAXRUN;
+    for (i = 0; i < n; i++) {
+      to[i] = bget(log.dev, log.start+tail+i+1); // log block, overwritten
+      struct buf *from = bread(log.dev, log.lh.sector[tail+i]); // cache block
+      memmove(to[i]->data, from->data, BSIZE);
+      brelse(from);
+    }
+    bwriten(to, n);  // write the log
+    for (i = 0; i < n; i++)
+      brelse(to[i]);
+  }
+}
+
+// Write the committed blocks, still pinned in the cache, to
+// their home locations in sector order.  This unpins them.
+static void
+install_cached(void)
+{
+  struct buf *dbuf[MAXRUN];
+  int i, j, n, s;
+
+  for (i = 1; i < log.lh.n; i++) {
+    s = log.lh.sector[i];
+    for (j = i; j > 0 && log.lh.sector[j-1] > s; j--)
+      log.lh.sector[j] = log.lh.sector[j-1];
+    log.lh.sector[j] = s;
+  }
+  // Runs of consecutive sectors go in one write each.
+  for (i = 0; i < log.lh.n; i += n) {
+    for (n = 1; i+n < log.lh.n && n < MAXRUN; n++)
+      if (log.lh.sector[i+n] != log.lh.sector[i] + n)
+        break;
+    for (j = 0; j < n; j++)
+      dbuf[j] = bread(log.dev, log.lh.sector[i+j]);
+    bwriten(dbuf, n);
+    for (j = 0; j < n; j++)
+      brelse(dbuf[j]);
+  }
 }
 
 // Copy committed blocks from log to their home location
@@ -122,6 +187,20 @@ recover_from_log(void)
   write_head(); // clear the log
 }
 
+// Commit the transactions since the last commit.  The caller
+// holds the log (log.busy).
+static void
+commit(void)
+{
+  if (log.lh.n > 0) {
+    write_log();      // Write modified blocks from cache to log
+    write_head();     // Write header to disk -- the real commit
+    install_cached(); // Now install writes to home locations
+    log.lh.n = 0; 
+    write_head();     // Erase the transaction from the log
+  }
+}
+
 void
 begin_trans(void)
 {
@@ -131,24 +210,49 @@ begin_trans(void)
   }
   log.busy = 1;
   release(&log.lock);
+  if (log.lh.n + MAXOPBLOCKS > LOGSIZE || log.lh.n + MAXOPBLOCKS >= log.size)
+    commit();
 }
 
 void
 commit_trans(void)
 {
-  if (log.lh.n > 0) {
-    write_head();    // Write header to disk -- the real commit
-    install_trans(); // Now install writes to home locations
-    log.lh.n = 0; 
-    write_head();    // Erase the transaction from the log
-  }
-  
   acquire(&log.lock);
   log.busy = 0;
   wakeup(&log);
   release(&log.lock);
 }
 
+// Commit whatever the log holds now.
+void
+logflush(void)
+{
+  begin_trans();
+  commit();
+  commit_trans();
+}
+
+// The flusher kernel thread: commit whatever the log holds
+// every FLUSHTICKS, or as soon as it is half full.
+static void
+logflusher(void)
+{
+  uint last;
+
+  acquire(&tickslock);
+  last = ticks;
+  for(;;){
+    // log.lh.n is only a hint here; commit() runs with the log held.
+    while(ticks - last < FLUSHTICKS && log.lh.n < LOGSIZE/2)
+      sleep(&ticks, &tickslock);
+    last = ticks;
+    release(&tickslock);
+
+    logflush();
+    acquire(&tickslock);
+  }
+}
+
 // Caller has modified b->data and is done with the buffer.
 // Append the block to the log and record the block number, 
 // but don't write the log header (which would commit the write).
@@ -157,28 +261,26 @@ commit_trans(void)
 //   modify bp->data[]
 //   log_write(bp)
 //   brelse(bp)
+// The block is written to the log at the next commit.
 void
 log_write(struct buf *b)
 {
   int i;
 
-  if (log.lh.n >= LOGSIZE || log.lh.n >= log.size - 1)
-    panic("too big a transaction");
   if (!log.busy)
     panic("write outside of trans");
 
   for (i = 0; i < log.lh.n; i++) {
-    if (log.lh.sector[i] == b->sector)   // log absorbtion?
+    if (log.lh.sector[i] == b->blockno)   // log absorbtion?
       break;
   }
-  log.lh.sector[i] = b->sector;
-  struct buf *lbuf = bread(b->dev, log.start+i+1);
-  memmove(lbuf->data, b->data, BSIZE);
-  bwrite(lbuf);
-  brelse(lbuf);
-  if (i == log.lh.n)
+  if (i == log.lh.n) {
+    if (log.lh.n >= LOGSIZE || log.lh.n >= log.size - 1)
+      panic("too big a transaction");
+    log.lh.sector[i] = b->blockno;
     log.lh.n++;
-  b->flags |= B_DIRTY; // XXX prevent eviction
+  }
+  b->flags |= B_DIRTY; // pinned in the cache until installed
 }
 
 //PAGEBREAK!
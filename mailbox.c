@@ -13,6 +13,7 @@
 #include "traps.h"
 #include "spinlock.h"
 #include "fs.h"
+#include "sleeplock.h"
 #include "file.h"
 #include "memlayout.h"
 #include "mmu.h"
@@ -83,7 +84,7 @@ writemailbox(uint *addr, u8 channel)
 
 	a = (uint)addr;
 	a -= KERNBASE;   /* convert to ARM physical address */
-	a += 0x40000000; /* convert to VC address space */
+	a += VCBUS;      /* convert to VC address space */
 	x = a & 0xfffffff0;
 	y = x | (uint)(channel & 0xf);
 
@@ -34,5 +34,6 @@
 #define MPI_TAG_GET_FIRMWARE		0x00000001
 #define MPI_TAG_GET_CLOCK_STATE		0x00030001
 #define MPI_TAG_SET_CLOCK_STATE		0x00038001
+#define MPI_TAG_GET_CLOCK_RATE		0x00030002
 
 
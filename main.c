@@ -45,6 +45,7 @@ void NotOkLoop()
 void machinit(void)
 {
     memset(cpus, 0, sizeof(struct cpu)*NCPU);
+    setmycpu(&cpus[0]);
 }
 
 
@@ -91,9 +92,13 @@ void draw_logo_colored() {
 
 int cmain( uint r0)
 {
-  
+  uint rdsize;
+
+
   mmuinit1();
   machinit();
+  vfpinit();
+  softirqinit();
   uartinit();
   dsb_barrier();
   framebufferinit(); // init graphics framebuffer
@@ -101,6 +106,8 @@ int cmain( uint r0)
   draw_logo_colored();
   kinit1(end, P2V(8*1024*1024));  // reserve 8 pages for PGDIR
   kpgdir=p2v(K_PDX_BASE);
+  vdsoinit();
+  startothers(); // they wait for releaseothers()
 
   mailboxinit();
   create_request(mailbuffer, MPI_TAG_GET_ARM_MEMORY, 8, 0, 0);
@@ -112,21 +119,29 @@ int cmain( uint r0)
     cprintf("ARM memory is %x %x\n", mailbuffer[MB_HEADER_LENGTH + TAG_HEADER_LENGTH], mailbuffer[MB_HEADER_LENGTH + TAG_HEADER_LENGTH+1]);
 
   pinit();
+  syscallinit();
   tvinit();
   cprintf("it is ok after tvinit\n");
-  binit();
-cprintf("it is ok after binit\n");
   fileinit();
 cprintf("it is ok after fileinit\n");
   iinit();
 cprintf("it is ok after iinit\n");
   ideinit();
 cprintf("it is ok after ideinit\n");
+  sdinit();
+  diskinit();
   timer3init();
-  kinit2(P2V(8*1024*1024), P2V(PHYSTOP));
+  rdsize = rdinit(); // before kinit2 frees the pages under it
+  kinit2(P2V(8*1024*1024), P2V(RDBASE));
+  kinit2(P2V(RDBASE + rdsize), P2V(PHYSTOP));
 cprintf("it is ok after kinit2\n");
+  binit();
+cprintf("it is ok after binit\n");
   userinit();
 cprintf("it is ok after userinit\n");
+  softirqstart();
+  releaseothers();
+  cprintf("%d cpus\n", ncpu);
   scheduler();
 
 
@@ -1,58 +1,54 @@
 // Fake IDE disk; stores blocks in memory.
 // Useful for running kernel without scratch disk.
+// A driver for the block layer (blk.c) that never interrupts.
 
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "fs.h"
 #include "mmu.h"
 #include "proc.h"
 #include "arm.h"
 #include "traps.h"
 #include "spinlock.h"
+#include "sleeplock.h"
 #include "buf.h"
+#include "blk.h"
 
 extern uchar _binary_fs_img_start[], _binary_fs_img_end[];
 
 static int disksize;
 static uchar *memdisk;
 
-void
-ideinit(void)
+// Do the transfer at once: the disk is memory.
+static int
+memdiskstart(struct blkdev *d, struct buf *b, int n)
 {
-  memdisk = _binary_fs_img_start;
-  disksize = div(((uint)_binary_fs_img_end - (uint)_binary_fs_img_start), 512);
-}
+  uchar *p;
 
-// Interrupt handler.
-void
-ideintr(void)
-{
-  // no-op
+  for(; b; b = b->qnext){
+    if(b->blockno >= disksize / (BSIZE/SECTSIZE))
+      panic("memdisk: block out of range");
+    p = memdisk + b->blockno*BSIZE;
+    if(b->flags & B_DIRTY)
+      memmove(p, b->data, BSIZE);
+    else
+      memmove(b->data, p, BSIZE);
+  }
+  return 1;
 }
 
-// Sync buf with disk. 
-// If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
-// Else if B_VALID is not set, read buf from disk, set B_VALID.
+static struct blkdev memdiskdev = {
+  .name = "memdisk",
+  .start = memdiskstart,
+  .maxmerge = 16,
+};
+
 void
-iderw(struct buf *b)
+ideinit(void)
 {
-  uchar *p;
-
-  if(!(b->flags & B_BUSY))
-    panic("iderw: buf not busy");
-  if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
-    panic("iderw: nothing to do");
-  if(b->dev != 1)
-    panic("iderw: request not for disk 1");
-  if(b->sector >= disksize)
-    panic("iderw: sector out of range");
-
-  p = memdisk + b->sector*512;
-  
-  if(b->flags & B_DIRTY){
-    b->flags &= ~B_DIRTY;
-    memmove(p, b->data, 512);
-  } else
-    memmove(b->data, p, 512);
-  b->flags |= B_VALID;
+  memdisk = _binary_fs_img_start;
+  disksize = div(((uint)_binary_fs_img_end - (uint)_binary_fs_img_start), SECTSIZE);
+  memdiskdev.size = disksize;
+  blkregister(MEMDISKDEV, &memdiskdev);
 }
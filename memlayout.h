@@ -21,13 +21,39 @@
 #define GPUMEMSIZE	(1024*MBYTE)
 
 #define PA_START 	0x0
+#ifdef RPI2
+#define PHYSIO          0x3F000000
+#define LOCALPHYS       0x40000000      /* BCM2836 per-core timers, mailboxes and irqs */
+#define LOCALSPACE      0xFF000000      /* ... mapped here, one section */
+#else
 #define PHYSIO          0x20000000
+#endif
+
+// RAM and the i/o registers as the VideoCore and the DMA
+// engines address them
+#ifdef RPI2
+#define VCBUS	0xC0000000 /* uncached alias: the Cortex-A7 caches are not shared with the VC */
+#else
+#define VCBUS	0x40000000
+#endif
+#define BUSIO	0x7E000000
+
+// A RAM disk image the boot loader may have put in RAM (ramdisk.c)
+#define RDBASE		0x04000000
+#define RDMAX		(64*MBYTE)
+
+// The BCM2835 system timer and its free-running 1MHz counter
+#define SYSTIMER	(DEVSPACE+0x3000)
+#define SYSTIMER_CLO	(SYSTIMER+0x4)
+
 #define RAMSIZE         0xC000000
 #define IOSIZE          (16*MBYTE)
 #define TVSIZE          0x1000
 
+#ifndef __ASSEMBLER__
 static inline uint v2p(void *a) { return ((uint) (a))  - KERNBASE; }
 static inline void *p2v(uint a) { return (void *) ((a) + KERNBASE); }
+#endif
 
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) (((void *) (a)) + KERNBASE)
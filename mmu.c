@@ -12,7 +12,7 @@
 #include "mmu.h"
 
 
-#define IO_BASE 0x20000000
+#define IO_BASE PHYSIO
 
 // BCM2835 ARM peripherals - Page 89
 #define GPFSEL1         (IO_BASE + 0x00200004) // GPIO Function Select 1
@@ -110,9 +110,9 @@ void _puts(const char *s)
 void __uart_putc ( unsigned int c )
 {
   while(1) {
-    if(read32(0x20215054 + 0xDE000000)&0x20) break;
+    if(read32(DEVSPACE + 0x215054)&0x20) break;
   }
-  write32(0x20215040 + 0xDE000000,c);
+  write32(DEVSPACE + 0x215040,c);
 }
 
 void __puts(const char *s)
@@ -125,6 +125,38 @@ void __puts(const char *s)
 }
 
 
+// Load the domain and translation table registers and turn on
+// the MMU, caches and high vectors.  Runs at its physical address
+// on every cpu, with kpgdir identity-mapping the code.
+static void
+mmuenable(void)
+{
+	asm volatile(
+#ifdef RPI2
+		"mrc p15, 0, r0, c1, c0, 1\n\t"
+		"orr r0, #0x00000040\n\t" /* ACTLR.SMP: join the coherency domain */
+		"mcr p15, 0, r0, c1, c0, 1\n\t"
+#endif
+		"mov r1, #1\n\t"
+                "mcr p15, 0, r1, c3, c0\n\t"
+                "mcr p15, 0, %0, c2, c0, 0\n\t" /* TTBR0 */
+                "mcr p15, 0, %0, c2, c0, 1\n\t" /* TTBR1 */
+                "mcr p15, 0, %1, c2, c0, 2\n\t" /* TTBCR */
+                "mrc p15, 0, r0, c1, c0, 0\n\t"
+                "mov r1, #0x00002000\n\t"
+                "orr r1, #0x00000004\n\t"
+                "orr r1, #0x00001000\n\t"
+                "orr r1, #0x00000001\n\t"
+		"orr r0, r1\n\t"
+		"mcr p15, 0, r0, c1, c0, 0\n\t"
+#ifndef RPI2
+		"mov r1, #1\n\t"
+		"mcr p15, 0, r1, c15, c12, 0\n\t"
+#endif
+                :: "r"(K_PDX_BASE|TTB_ATTR), "r"(TTBCR_N)
+                : "r0", "r1", "cc", "memory");
+}
+
 void mmuinit0(void)
 {
   pde_t *l1;
@@ -145,7 +177,11 @@ void mmuinit0(void)
 		"bic r1,r1,#0x00000001\n\t"
 		"mcr p15, 0, r1, c1, c0, 0\n\t"
 		"mov r0, #0\n\t"
+#ifdef RPI2
+		"mcr p15, 0, r0, c7, c5, 0\n\t"
+#else
 		"mcr p15, 0, r0, c7, c7, 0\n\t"
+#endif
 		"mcr p15, 0, r0, c8, c7, 0\n\t"
 		::: "r0", "r1", "cc", "memory");
 
@@ -158,7 +194,7 @@ void mmuinit0(void)
         // map all of ram at KERNBASE
 	va = KERNBASE;
 	for(pa = PA_START; pa < PA_START+RAMSIZE; pa += MBYTE){
-                l1[PDX(va)] = pa|DOMAIN0|PDX_AP(K_RW)|SECTION|CACHED|BUFFERED;
+                l1[PDX(va)] = pa|DOMAIN0|PDX_AP(K_RW)|SECTION|CACHED|BUFFERED|PDX_SHARED;
                 va += MBYTE;
         }
 
@@ -174,38 +210,40 @@ void mmuinit0(void)
 
 	// map GPU memory
 	va = GPUMEMBASE;
+#ifdef RPI2
+	// BCM2836 physical 0x40000000 is the local block, not a
+	// bus alias of ram; map all of ram here for the framebuffer
+	for(pa = PA_START; pa < PA_START+(uint)GPUMEMSIZE; pa += MBYTE){
+#else
 	for(pa = GPUMEMBASE; pa < (uint)GPUMEMBASE+(uint)GPUMEMSIZE; pa += MBYTE){
+#endif
 		l1[PDX(va)] = pa|DOMAIN0|PDX_AP(K_RW)|SECTION;
 		va += MBYTE;
 	}
 
+#ifdef RPI2
+	// map the per-core timers, mailboxes and interrupt registers
+	l1[PDX(LOCALSPACE)] = LOCALPHYS|DOMAIN0|PDX_AP(K_RW)|SECTION;
+#endif
+
         // double map exception vectors at top of virtual memory
         va = HVECTORS;
         l1[PDX(va)] = (uint)l2|DOMAIN0|COARSE;
         l2[PTX(va)] = PA_START|PTX_AP(K_RW)|SMALL;
 
 
-	asm volatile("mov r1, #1\n\t"
-                "mcr p15, 0, r1, c3, c0\n\t"
-                "mov r1, #0x4000\n\t"
-                "mcr p15, 0, r1, c2, c0\n\t"
-                "mrc p15, 0, r0, c1, c0, 0\n\t"
-                "mov r1, #0x00002000\n\t"
-                "orr r1, #0x00000004\n\t"
-                "orr r1, #0x00001000\n\t"
-                "orr r1, #0x00000001\n\t"
-		"orr r0, r1\n\t"
-		"mcr p15, 0, r0, c1, c0, 0\n\t"
-		"mov r1, #1\n\t"
-		"mcr p15, 0, r1, c15, c12, 0\n\t"
-                ::: "r0", "r1", "cc", "memory");
+	mmuenable();
 
   //__puts("mmu started ...\n");
   
     uint val = 0;
 
     // flush all TLB
+#ifdef RPI2
+    asm("MCR p15, 0, %[r], c7, c5, 0" : :[r]"r" (val):);
+#else
     asm("MCR p15, 0, %[r], c7, c7, 0" : :[r]"r" (val):);
+#endif
     asm("MCR p15, 0, %[r], c8, c7, 0" : :[r]"r" (val):);
   //__puts("mmu flush ...\n");
 
@@ -234,3 +272,15 @@ mmuinit1(void)
   //__puts("mmu mmuinit1 flush ...\n");
 }
 
+
+// Turn on the MMU of a secondary cpu; see mpentry in entry.s.
+// startothers() has put the identity map back for us.
+void
+mmuinitap(void)
+{
+  uint val = 0;
+
+  mmuenable();
+  asm("MCR p15, 0, %[r], c7, c5, 0" : :[r]"r" (val):);
+  asm("MCR p15, 0, %[r], c8, c7, 0" : :[r]"r" (val):);
+}
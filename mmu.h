@@ -34,11 +34,31 @@
 
 #define ACCESS_PERM(n, v)	(((v) & 3) << (((n) * 2) + 4))
 #define PDX_AP(ap)		(ACCESS_PERM(3, (ap)))
+#ifdef RPI2
+// ARMv7 has no subpages: a small page has one AP field in
+// bits 5:4, and bits 11:6 hold TEX, APX, S and nG instead.
+#define PTX_AP(ap) 		(ACCESS_PERM(0, (ap)))
+#define PDX_SHARED		(1<<16)
+#define PTX_SHARED		(1<<10)
+#else
 #define PTX_AP(ap) 		(ACCESS_PERM(3, (ap)) | ACCESS_PERM(2, (ap)) \
 				| ACCESS_PERM(1, (ap)) | ACCESS_PERM(0, (ap)))
+#define PDX_SHARED		0
+#define PTX_SHARED		0
+#endif
 
 #define HVECTORS        0xffff0000
 
+// TTBCR.N = 2 splits translation: TTBR0 walks a 4KB table for
+// the low 1GB (user space, see USERBOUND), TTBR1 walks kpgdir
+// for the rest.  Each cpu points TTBR0 at its current process.
+#define TTBCR_N		2
+#ifdef RPI2
+#define TTB_ATTR	0x4A	// shareable, write-back cacheable walks
+#else
+#define TTB_ATTR	0
+#endif
+
 // A virtual address 'la' has a three-part structure as follows:
 //
 // +--------12------+-------8--------+---------12----------+
@@ -75,8 +95,8 @@
 
 #define PGDIR_BASE	P2V(K_PDX_BASE)
 
-#define KVMPDXATTR       DOMAIN0|PDX_AP(U_RW)|SECTION|CACHED|BUFFERED
+#define KVMPDXATTR       DOMAIN0|PDX_AP(U_RW)|SECTION|CACHED|BUFFERED|PDX_SHARED
 
 #define UVMPDXATTR 	DOMAIN0|COARSE
-#define UVMPTXATTR	PTX_AP(U_RW)|CACHED|BUFFERED|SMALL
+#define UVMPTXATTR	PTX_AP(U_RW)|CACHED|BUFFERED|SMALL|PTX_SHARED
 
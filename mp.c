@@ -0,0 +1,111 @@
+// Multi-core bring-up for the BCM2836 (Raspberry Pi 2).
+//
+// Core 0 boots the kernel.  The other cores wait, MMU off, on
+// their mailbox 3 in the BCM2836 local block (in park in entry.s,
+// or in the firmware's own loop on real hardware).  startothers()
+// writes mpentry's physical address there; each core turns on its
+// MMU, comes to mpmain() and waits until core 0 has finished
+// initialising the kernel before it enters its scheduler.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "arm.h"
+
+int ncpu = 1;
+
+#define NCORE			4
+#define CORE_MBOX3_SET(n)	(LOCALSPACE + 0x8C + 0x10*(n))
+
+extern char mpentry[];  // entry.s
+extern uint mpstack;    // entry.s; boot stack for the next core
+extern pde_t *kpgdir;
+
+static volatile int bootdone;
+
+int
+cpunum(void)
+{
+#ifdef RPI2
+  uint mpidr;
+
+  asm volatile("mrc p15, 0, %0, c0, c0, 5" : "=r"(mpidr));
+  return mpidr & 3;
+#else
+  return 0;
+#endif
+}
+
+// A secondary core arrives here from mpentry with paging on,
+// still running on the stack startothers() gave it.
+void
+mpmain(void)
+{
+  struct cpu *c;
+
+  c = &cpus[cpunum()];
+  setmycpu(c);
+  c->id = cpunum();
+  c->started = 1;
+  while(!bootdone)
+    ;
+  modestackinit();
+  vfpinit();
+#ifdef RPI2
+  localtimerinit();
+#endif
+  cprintf("cpu%d: starting\n", c->id);
+  scheduler();
+}
+
+// Start the other cores and wait for each to turn on its MMU.
+// The BCM2835 has only one.
+void
+startothers(void)
+{
+#ifdef RPI2
+  char *stack;
+  uint va;
+  int n, i;
+
+  // mpentry runs at its physical address until paging is on,
+  // so put back the identity map that mmuinit1 removed.
+  kpgdir[PDX(PA_START)] = PA_START|DOMAIN0|PDX_AP(K_RW)|SECTION|CACHED|BUFFERED|PDX_SHARED;
+  va = (uint)&kpgdir[PDX(PA_START)];
+  flush_dcache(va, va);
+
+  for(n = 1; n < NCORE && n < NCPU; n++){
+    if((stack = kalloc()) == 0)
+      panic("startothers");
+    // The core reads mpstack with its caches off.
+    mpstack = v2p(stack) + PGSIZE;
+    flush_dcache((uint)&mpstack, (uint)&mpstack);
+    outw(CORE_MBOX3_SET(n), v2p(mpentry));
+    asm volatile("sev");
+
+    for(i = 0; i < 1000 && cpus[n].started == 0; i++)
+      delay(100);
+    if(cpus[n].started == 0){
+      cprintf("cpu%d: did not start\n", n);
+      break;
+    }
+    ncpu++;
+  }
+
+  kpgdir[PDX(PA_START)] = 0;
+  flush_dcache(va, va);
+  flush_tlb();
+#endif
+}
+
+// Let the other cores into their schedulers.
+void
+releaseothers(void)
+{
+  dmb();
+  bootdone = 1;
+  asm volatile("sev");
+}
@@ -3,10 +3,22 @@
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
-#define NBUF         10  // size of disk block cache
+#define NBUF         40  // minimum size of disk block cache
+#define BCACHESHIFT   6  // ... which gets 1/64 of free memory at boot
+#define MAXRUN       16  // most sectors in one breadn() or bwriten()
 #define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
-#define ROOTDEV       1  // device number of file system root disk
+#define MEMDISKDEV    1  // block device of the fs.img in the kernel
+#define SDDEV         2  // block device of the SD card
+#define RDDEV         3  // block device of the RAM disk at RDBASE
+#if defined(SDROOT)
+#define ROOTDEV   SDDEV  // device number of file system root disk
+#elif defined(RDROOT)
+#define ROOTDEV   RDDEV
+#else
+#define ROOTDEV MEMDISKDEV
+#endif
 #define MAXARG       32  // max exec arguments
-#define LOGSIZE      10  // max data sectors in on-disk log
+#define MAXOPBLOCKS  10  // max # of blocks any FS op writes
+#define LOGSIZE      (MAXOPBLOCKS*3)  // max data sectors in on-disk log
 
@@ -15,10 +15,15 @@
 #include "arm.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "pstat.h"
+
+#define NPIDHASH 64  // must be a power of two
+#define PIDHASH(pid) ((pid) & (NPIDHASH-1))
 
 struct {
   struct spinlock lock;
   struct proc proc[NPROC];
+  struct proc *pidhash[NPIDHASH];  // live processes, chained through hnext
 } ptable;
 
 static struct proc *initproc;
@@ -30,6 +35,7 @@ extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static void kthreadret(void);
 
 void
 pinit(void)
@@ -39,6 +45,71 @@ pinit(void)
 
 }
 
+// The process running on this cpu, or 0.  Interrupts are off
+// while reading it so that we are not rescheduled on another
+// cpu between finding our struct cpu and reading its proc.
+// This is too short and too common to go through pushcli(),
+// which IRQTRACE would time as an interrupts-off section.
+// Code that already runs with interrupts off, or uses the
+// process more than once, should read it once into a local.
+struct proc*
+myproc(void)
+{
+  struct proc *p;
+
+  if(readcpsr() & PSR_DISABLE_IRQ)
+    return curr_cpu->proc;
+  cli();
+  p = curr_cpu->proc;
+  sti();
+  return p;
+}
+
+// Pid hash and child lists.  The ptable lock must be held.
+static void
+pidhash_add(struct proc *p)
+{
+  struct proc **hp;
+
+  hp = &ptable.pidhash[PIDHASH(p->pid)];
+  p->hnext = *hp;
+  *hp = p;
+}
+
+static void
+pidhash_del(struct proc *p)
+{
+  struct proc **hp;
+
+  for(hp = &ptable.pidhash[PIDHASH(p->pid)]; *hp; hp = &(*hp)->hnext){
+    if(*hp == p){
+      *hp = p->hnext;
+      p->hnext = 0;
+      return;
+    }
+  }
+  panic("pidhash_del");
+}
+
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[PIDHASH(pid)]; p; p = p->hnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+static void
+addchild(struct proc *parent, struct proc *p)
+{
+  p->parent = parent;
+  p->sibling = parent->children;
+  parent->children = p;
+}
+
 //PAGEBREAK: 32
 // Look in the process table for an UNUSED proc.
 // If found, change state to EMBRYO and initialize
@@ -60,11 +131,25 @@ allocproc(void)
 found:
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->utime = p->stime = 0;
+  p->nvcsw = p->nivcsw = 0;
+  p->nsyscall = p->npgfault = 0;
+  p->parent = 0;
+  p->children = 0;
+  p->sibling = 0;
+  p->isthread = 0;
+  p->growing = 0;
+  p->usedvfp = 0;
+  p->tracemask[0] = p->tracemask[1] = 0;
+  pidhash_add(p);
   release(&ptable.lock);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
+    acquire(&ptable.lock);
+    pidhash_del(p);
     p->state = UNUSED;
+    release(&ptable.lock);
     return 0;
   }
   memset(p->kstack, 0, PGSIZE);
@@ -117,23 +202,66 @@ userinit(void)
   p->state = RUNNABLE;
 }
 
+// Start a kernel thread running fn, which must never return.
+// It has no user memory; kthreadret "returns" into fn.
+struct proc*
+kthread(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0 || (p->pgdir = setupkvm()) == 0)
+    panic("kthread");
+  p->context->pc = (uint)kthreadret;
+  p->context->lr = (uint)fn;
+  safestrcpy(p->name, name, sizeof(p->name));
+  acquire(&ptable.lock);
+  p->state = RUNNABLE;
+  release(&ptable.lock);
+  return p;
+}
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
+// Threads growing a shared pgdir take turns through the group
+// leader's growing flag, so the ptable lock is only held to
+// take the turn and to give every thread the new sz, not while
+// allocuvm() clears pages.
 int
 growproc(int n)
 {
-  uint sz;
+  struct proc *curproc = curr_proc;
+  uint sz, newsz;
+  struct proc *p, *leader;
 
-  sz = curr_proc->sz;
-  if(n > 0){
-    if((sz = allocuvm(curr_proc->pgdir, sz, sz + n)) == 0)
-      return -1;
-  } else if(n < 0){
-    if((sz = deallocuvm(curr_proc->pgdir, sz, sz + n)) == 0)
-      return -1;
+  leader = curproc->isthread ? curproc->parent : curproc;
+  acquire(&ptable.lock);
+  while(leader->growing)
+    sleep(&leader->growing, &ptable.lock);
+  leader->growing = 1;
+  sz = curproc->sz;
+  release(&ptable.lock);
+
+  newsz = sz;
+  if(n > 0)
+    newsz = allocuvm(curproc->pgdir, sz, sz + n);
+  else if(n < 0){
+    newsz = deallocuvm(curproc->pgdir, sz, sz + n);
+    flush_tlb_all();
+  }
+
+  acquire(&ptable.lock);
+  if(newsz != 0){
+    leader->sz = newsz;
+    for(p = leader->children; p; p = p->sibling)
+      if(p->isthread)
+        p->sz = newsz;
   }
-  curr_proc->sz = sz;
-  switchuvm(curr_proc);
+  leader->growing = 0;
+  wakeup1(&leader->growing);
+  release(&ptable.lock);
+  if(newsz == 0)
+    return -1;
+  switchuvm(curproc);
   return 0;
 }
 
@@ -143,6 +271,7 @@ growproc(int n)
 int
 fork(void)
 {
+  struct proc *curproc = curr_proc;
   int i, pid;
   struct proc *np;
 
@@ -151,69 +280,198 @@ fork(void)
     return -1;
 
   // Copy process state from p.
-  if((np->pgdir = copyuvm(curr_proc->pgdir, curr_proc->sz)) == 0){
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
+    acquire(&ptable.lock);
+    pidhash_del(np);
     np->state = UNUSED;
+    release(&ptable.lock);
     return -1;
   }
-  np->sz = curr_proc->sz;
-  np->parent = curr_proc;
-  *np->tf = *curr_proc->tf;
+  np->sz = curproc->sz;
+  *np->tf = *curproc->tf;
+  vfpflush(curproc);
+  np->usedvfp = curproc->usedvfp;
+  np->vfp = curproc->vfp;
+  np->tracemask[0] = curproc->tracemask[0];
+  np->tracemask[1] = curproc->tracemask[1];
 
   // Clear r0 so that fork returns 0 in the child.
   np->tf->r0 = 0;
 
   for(i = 0; i < NOFILE; i++)
-    if(curr_proc->ofile[i])
-      np->ofile[i] = filedup(curr_proc->ofile[i]);
-  np->cwd = idup(curr_proc->cwd);
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
  
   pid = np->pid;
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+  acquire(&ptable.lock);
+  addchild(curproc, np);
   np->state = RUNNABLE;
-  safestrcpy(np->name, curr_proc->name, sizeof(curr_proc->name));
+  release(&ptable.lock);
   return pid;
 }
 
+// Create a new thread in the current process that starts
+// running fn(arg) in user space on the stack ending at stack.
+// The thread gets its own kernel stack and trap frame but
+// shares the address space.  Its descriptors are a copy of the
+// caller's, made as fork makes them: files one thread opens or
+// closes later are not seen by the others.  All threads are
+// children of the group leader and are reaped with join().
+int
+clone(uint fn, uint arg, uint stack)
+{
+  struct proc *curproc = curr_proc;
+  int i, tid;
+  struct proc *np, *leader;
+
+  if(fn >= curproc->sz || stack > curproc->sz || stack < 8)
+    return -1;
+
+  if((np = allocproc()) == 0)
+    return -1;
+
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  np->isthread = 1;
+  np->tracemask[0] = curproc->tracemask[0];
+  np->tracemask[1] = curproc->tracemask[1];
+  *np->tf = *curproc->tf;
+  np->tf->pc = fn;
+  np->tf->r0 = arg;
+  np->tf->sp = stack & ~7;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+
+  tid = np->pid;
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+  leader = curproc->isthread ? curproc->parent : curproc;
+  acquire(&ptable.lock);
+  addchild(leader, np);
+  np->state = RUNNABLE;
+  release(&ptable.lock);
+  return tid;
+}
+
+// Release a zombie's resources and return its slot to the table.
+// The address space is the leader's to free, not a thread's.
+// The ptable lock must be held and p unlinked from its parent.
+static void
+freeproc(struct proc *p)
+{
+  pidhash_del(p);
+  kfree(p->kstack);
+  p->kstack = 0;
+  if(!p->isthread)
+    freevm(p->pgdir);
+  p->pgdir = 0;
+  p->state = UNUSED;
+  p->pid = 0;
+  p->parent = 0;
+  p->sibling = 0;
+  p->isthread = 0;
+  vfpforget(p);
+  p->name[0] = 0;
+  p->killed = 0;
+}
+
+// Kill the other threads of the calling group leader and wait
+// until all of them have been reaped, so that the leader can
+// free or replace the shared address space.
+void
+killthreads(void)
+{
+  struct proc *curproc = curr_proc;
+  struct proc *p, **pp;
+  int havethreads;
+
+  if(curproc->isthread)
+    panic("killthreads");
+
+  acquire(&ptable.lock);
+  for(;;){
+    havethreads = 0;
+    pp = &curproc->children;
+    while((p = *pp) != 0){
+      if(!p->isthread){
+        pp = &p->sibling;
+        continue;
+      }
+      if(p->state == ZOMBIE){
+        *pp = p->sibling;
+        freeproc(p);
+        continue;
+      }
+      havethreads = 1;
+      p->killed = 1;
+      if(p->state == SLEEPING)
+        p->state = RUNNABLE;
+      pp = &p->sibling;
+    }
+    if(!havethreads)
+      break;
+    // Exiting threads wake us through wakeup1(parent).
+    sleep(curproc, &ptable.lock);
+  }
+  release(&ptable.lock);
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
 void
 exit(void)
 {
+  struct proc *curproc = curr_proc;
   struct proc *p;
   int fd;
 
-  if(curr_proc == initproc)
+  if(curproc == initproc)
     panic("init exiting");
 
+  // The leader takes its threads down with it.
+  if(!curproc->isthread)
+    killthreads();
+
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
-    if(curr_proc->ofile[fd]){
-      fileclose(curr_proc->ofile[fd]);
-      curr_proc->ofile[fd] = 0;
+    if(curproc->ofile[fd]){
+      fileclose(curproc->ofile[fd]);
+      curproc->ofile[fd] = 0;
     }
   }
 
-  iput(curr_proc->cwd);
-  curr_proc->cwd = 0;
+  iput(curproc->cwd);
+  curproc->cwd = 0;
 
   acquire(&ptable.lock);
 
   // Parent might be sleeping in wait().
-  wakeup1(curr_proc->parent);
+  wakeup1(curproc->parent);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == curr_proc){
+  if((p = curproc->children) != 0){
+    for(;;){
       p->parent = initproc;
       if(p->state == ZOMBIE)
         wakeup1(initproc);
+      if(p->sibling == 0)
+        break;
+      p = p->sibling;
     }
+    p->sibling = initproc->children;
+    initproc->children = curproc->children;
+    curproc->children = 0;
   }
 
   // Jump into the scheduler, never to return.
-  curr_proc->state = ZOMBIE;
+  curproc->state = ZOMBIE;
   sched();
   panic("zombie exit");
 }
@@ -223,41 +481,72 @@ exit(void)
 int
 wait(void)
 {
-  struct proc *p;
+  struct proc *curproc = curr_proc;
+  struct proc *p, **pp;
   int havekids, pid;
 
   acquire(&ptable.lock);
   for(;;){
-    // Scan through table looking for zombie children.
+    // Scan through our children looking for zombies.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curr_proc)
-        continue;
+    for(pp = &curproc->children; (p = *pp) != 0; pp = &p->sibling){
+      if(p->isthread)
+        continue;  // threads are reaped by join()
       havekids = 1;
       if(p->state == ZOMBIE){
         // Found one.
+        *pp = p->sibling;
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->state = UNUSED;
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
+        freeproc(p);
         release(&ptable.lock);
         return pid;
       }
     }
 
     // No point waiting if we don't have any children.
-    if(!havekids || curr_proc->killed){
+    if(!havekids || curproc->killed){
       release(&ptable.lock);
       return -1;
     }
 //cprintf("inside wait before calling sleep\n");
     // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-    sleep(curr_proc, &ptable.lock);  //DOC: wait-sleep
+    sleep(curproc, &ptable.lock);  //DOC: wait-sleep
+  }
+}
+
+// Wait for another thread of the caller's group to exit and
+// return its thread id.  Return -1 if there are no such threads.
+int
+join(void)
+{
+  struct proc *curproc = curr_proc;
+  struct proc *p, **pp, *leader;
+  int havethreads, tid;
+
+  leader = curproc->isthread ? curproc->parent : curproc;
+  acquire(&ptable.lock);
+  for(;;){
+    havethreads = 0;
+    for(pp = &leader->children; (p = *pp) != 0; pp = &p->sibling){
+      if(!p->isthread || p == curproc)
+        continue;
+      havethreads = 1;
+      if(p->state == ZOMBIE){
+        *pp = p->sibling;
+        tid = p->pid;
+        freeproc(p);
+        release(&ptable.lock);
+        return tid;
+      }
+    }
+
+    if(!havethreads || curproc->killed){
+      release(&ptable.lock);
+      return -1;
+    }
+
+    // Exiting threads wake their parent, the leader.
+    sleep(leader, &ptable.lock);
   }
 }
 
@@ -289,19 +578,21 @@ scheduler(void)
       // Switch to chosen process.  It is the process's job
       // to release ptable.lock and then reacquire it
       // before jumping back to us.
-      curr_proc = p;
+      curr_cpu->proc = p;
 //cprintf("before switching page table\n");
       switchuvm(p);
       p->state = RUNNING;
 //cprintf("after switching page table\n");
+      vfpswitchin(p);
 
-      swtch(&curr_cpu->scheduler, curr_proc->context);
+      swtch(&curr_cpu->scheduler, p->context);
 
+      vfpswitchout(p);
       switchkvm();
 
       // Process is done running for now.
       // It should have changed its p->state before coming back.
-      curr_proc = 0;
+      curr_cpu->proc = 0;
     }
     release(&ptable.lock);
 
@@ -313,18 +604,19 @@ scheduler(void)
 void
 sched(void)
 {
+  struct proc *curproc = curr_cpu->proc;  // ptable.lock is held
   int intena;
 
   if(!holding(&ptable.lock))
     panic("sched ptable.lock");
   if(curr_cpu->ncli != 1)
     panic("sched locks");
-  if(curr_proc->state == RUNNING)
+  if(curproc->state == RUNNING)
     panic("sched running");
   if(!(readcpsr()&PSR_DISABLE_IRQ))
     panic("sched interruptible");
   intena = curr_cpu->intena;
-  swtch(&curr_proc->context, curr_cpu->scheduler);
+  swtch(&curproc->context, curr_cpu->scheduler);
   curr_cpu->intena = intena;
 }
 
@@ -332,8 +624,12 @@ sched(void)
 void
 yield(void)
 {
+  struct proc *p;
+
   acquire(&ptable.lock);  //DOC: yieldlock
-  curr_proc->state = RUNNABLE;
+  p = curr_cpu->proc;
+  p->state = RUNNABLE;
+  p->nivcsw++;
   sched();
   release(&ptable.lock);
 }
@@ -359,12 +655,25 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
+// A kernel thread's very first scheduling will swtch here.
+// Unlike forkret it never runs initlog(): that is left to the
+// first user process, which must not reach the file system
+// before the log is recovered.  "Return" into the thread's fn.
+static void
+kthreadret(void)
+{
+  // Still holding ptable.lock from scheduler.
+  release(&ptable.lock);
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
 sleep(void *chan, struct spinlock *lk)
 {
-  if(curr_proc == 0)
+  // The caller holds lk, so interrupts are already off.
+  struct proc *curproc = curr_cpu->proc;
+  if(curproc == 0)
     panic("sleep");
 
   if(lk == 0)
@@ -382,13 +691,14 @@ sleep(void *chan, struct spinlock *lk)
   }
 
   // Go to sleep.
-  curr_proc->chan = chan;
-  curr_proc->state = SLEEPING;
+  curproc->chan = chan;
+  curproc->state = SLEEPING;
+  curproc->nvcsw++;
 //cprintf("inside sleep before calling sched\n");
   sched();
 
   // Tidy up.
-  curr_proc->chan = 0;
+  curproc->chan = 0;
 
   // Reacquire original lock.
   if(lk != &ptable.lock){  //DOC: sleeplock2
@@ -419,6 +729,94 @@ wakeup(void *chan)
   release(&ptable.lock);
 }
 
+// Wake p alone if it is still sleeping on chan, without
+// scanning the process table.
+void
+wakeproc(struct proc *p, void *chan)
+{
+  acquire(&ptable.lock);
+  if(p->state == SLEEPING && p->chan == chan)
+    p->state = RUNNABLE;
+  release(&ptable.lock);
+}
+
+// Futexes: sleep on a user memory word until another process
+// or thread calls futexwake on the same word.  The channel is
+// the word's kernel address, so waiters are matched by physical
+// location no matter how it is mapped.  The ptable lock makes
+// the compare and the sleep atomic with respect to futexwake.
+static char*
+futexchan(uint addr)
+{
+  char *ka;
+
+  if(addr % 4 != 0 || addr >= curr_proc->sz)
+    return 0;
+  if((ka = uva2ka(curr_proc->pgdir, (char*)addr)) == 0)
+    return 0;
+  return ka + (addr & (PGSIZE-1));
+}
+
+// If the word at addr still holds val, sleep until woken.
+// Return 0 if woken, -1 if the value had already changed.
+int
+futexwait(uint addr, uint val)
+{
+  char *chan;
+
+  acquire(&ptable.lock);
+  if((chan = futexchan(addr)) == 0 || *(uint*)chan != val){
+    release(&ptable.lock);
+    return -1;
+  }
+  sleep(chan, &ptable.lock);
+  release(&ptable.lock);
+  return 0;
+}
+
+// Wake up to n processes waiting on the word at addr.
+// Return the number woken.
+int
+futexwake(uint addr, int n)
+{
+  struct proc *p;
+  char *chan;
+  int woken;
+
+  woken = 0;
+  acquire(&ptable.lock);
+  if((chan = futexchan(addr)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && woken < n; p++){
+    if(p->state == SLEEPING && p->chan == chan){
+      p->state = RUNNABLE;
+      woken++;
+    }
+  }
+  release(&ptable.lock);
+  return woken;
+}
+
+// Trace the system calls in mask (bit n for call n) made by
+// process pid and, from now on, by its new children.
+int
+settrace(int pid, uint lo, uint hi)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  if((p = findproc(pid)) == 0){
+    release(&ptable.lock);
+    return -1;
+  }
+  p->tracemask[0] = lo;
+  p->tracemask[1] = hi;
+  release(&ptable.lock);
+  return 0;
+}
+
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
@@ -428,15 +826,13 @@ kill(int pid)
   struct proc *p;
 
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
+  if((p = findproc(pid)) != 0){
+    p->killed = 1;
+    // Wake process from sleep if necessary.
+    if(p->state == SLEEPING)
+      p->state = RUNNABLE;
+    release(&ptable.lock);
+    return 0;
   }
   release(&ptable.lock);
   return -1;
@@ -449,6 +845,60 @@ kill(int pid)
 void
 procdump(void)
 {
+  static char *states[] = {
+  [UNUSED]    "unused",
+  [EMBRYO]    "embryo",
+  [SLEEPING]  "sleep ",
+  [RUNNABLE]  "runble",
+  [RUNNING]   "run   ",
+  [ZOMBIE]    "zombie"
+  };
+  struct proc *p;
+  char *state;
+
+  cprintf("\npid ppid state  user  sys   vcsw  ivcsw syscall fault name\n");
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state == UNUSED)
+      continue;
+    if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
+      state = states[p->state];
+    else
+      state = "???";
+    cprintf("%d %d %s %d %d %d %d %d %d %s\n", p->pid,
+            p->parent ? p->parent->pid : 0, state, p->utime, p->stime,
+            p->nvcsw, p->nivcsw, p->nsyscall, p->npgfault, p->name);
+  }
+}
+
+// Copy the statistics of up to max live processes into ps.
+// Returns the number of entries filled in.
+int
+getprocs(struct pstat *ps, int max)
+{
+  struct proc *p;
+  int n;
+
+  n = 0;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && n < max; p++){
+    if(p->state == UNUSED)
+      continue;
+    ps->pid = p->pid;
+    ps->ppid = p->parent ? p->parent->pid : 0;
+    ps->state = p->state;
+    ps->sz = p->sz;
+    ps->utime = p->utime;
+    ps->stime = p->stime;
+    ps->nvcsw = p->nvcsw;
+    ps->nivcsw = p->nivcsw;
+    ps->nsyscall = p->nsyscall;
+    ps->npgfault = p->npgfault;
+    safestrcpy(ps->name, p->name, sizeof(ps->name));
+    ps++;
+    n++;
+  }
+  release(&ptable.lock);
+  return n;
 }
 
 
@@ -12,11 +12,15 @@
 
 // Per-CPU state
 struct cpu {
-  uchar id;                    // Local APIC ID; index into cpus[] below
+  uint irqstamp;               // System timer at IRQ entry; must be first,
+                               // do_irq in exception.S stores it (IRQTRACE)
+  uchar id;                    // Core number; index into cpus[] below
   struct context *scheduler;   // swtch() here to enter scheduler
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+  int insoftirq;               // Running softirq handlers?
+  struct proc *vfpowner;       // Whose registers are in the VFP unit
   
   // Cpu-local storage variables; see below
   struct cpu *cpu;
@@ -28,17 +32,27 @@ extern struct cpu cpus[NCPU];
 
 // Per-CPU variables, holding pointers to the
 // current cpu and to the current process.
-// The asm suffix tells gcc to use "%gs:0" to refer to cpu
-// and "%gs:4" to refer to proc.  seginit sets up the
-// %gs segment register so that %gs refers to the memory
-// holding those two variables in the local cpu's struct cpu.
-// This is similar to how thread-local variables are implemented
-// in thread libraries such as Linux pthreads.
-//extern struct cpu *cpu asm("%gs:0");       // &cpus[cpunum()]
-//extern struct proc *proc asm("%gs:4");     // cpus[cpunum()].proc
-
-#define curr_cpu (&cpus[0])
-#define curr_proc   (cpus[0].proc)
+// Each cpu keeps a pointer to its struct cpu in TPIDRPRW, a
+// CP15 register only the kernel can read, set as the cpu boots.
+// curr_proc goes through myproc(), which disables interrupts so
+// that the process cannot move to another cpu half way through.
+static inline struct cpu*
+mycpu(void)
+{
+  struct cpu *c;
+
+  asm volatile("mrc p15, 0, %0, c13, c0, 4" : "=r"(c));
+  return c;
+}
+
+static inline void
+setmycpu(struct cpu *c)
+{
+  asm volatile("mcr p15, 0, %0, c13, c0, 4" : : "r"(c));
+}
+
+#define curr_cpu (mycpu())
+#define curr_proc   (myproc())
 
 //PAGEBREAK: 17
 // Saved registers for kernel context switches.
@@ -67,6 +81,12 @@ struct context {
 
 enum procstate { UNUSED=0, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// VFP registers of a process that uses floating point.
+struct vfpstate {
+  uint d[32];                  // d0-d15
+  uint fpscr;
+};
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
@@ -75,13 +95,30 @@ struct proc {
   enum procstate state;        // Process state
   volatile int pid;            // Process ID
   struct proc *parent;         // Parent process
+  struct proc *children;       // First child; linked through sibling
+  struct proc *sibling;        // Next child of the same parent
+  struct proc *hnext;          // Next process in the same pid hash chain
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
+  int isthread;                // Shares pgdir with parent, its group leader
+  int growing;                 // Leader: a thread is in growproc()
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+
+  // Accounting, reported by getprocs() and procdump()
+  uint utime;                  // Timer ticks charged in user mode
+  uint stime;                  // Timer ticks charged in kernel mode
+  uint nvcsw;                  // Voluntary context switches (sleep)
+  uint nivcsw;                 // Involuntary context switches (preempted)
+  uint nsyscall;               // System calls made
+  uint npgfault;               // Prefetch/data aborts taken
+  uint tracemask[2];           // System calls to trace; see syscall.c
+
+  int usedvfp;                 // vfp holds its floating point registers
+  struct vfpstate vfp;         // Saved VFP registers; see vfp.c
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -0,0 +1,171 @@
+// RAM disk in a file system image that the boot loader put at
+// physical address RDBASE, for the block layer (blk.c).
+//
+// Unlike the memdisk (memide.c) the image is not linked into the
+// kernel, so it can be as large as RDMAX.  Under QEMU load it with
+//   -device loader,file=rd.img,addr=0x04000000
+// (QEMU ignores -initrd for ELF kernels); on a Pi, with
+//   initramfs rd.img 0x04000000
+// in config.txt.  rdinit() keeps the pages under the image out of
+// the allocator.
+//
+// Writes only change memory.  The driver remembers which blocks
+// they hit, and rdsync() (the sync system call) copies those back
+// to rd.img on the host through QEMU's semihosting interface when
+// the kernel is built with SEMIHOST; QEMU must run with
+// -semihosting.  A Pi has no host to write to, so there the RAM
+// disk is lost at power off.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "fs.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "buf.h"
+#include "blk.h"
+
+#define RDFILE	"rd.img"	// host file rdsync() writes
+
+static struct {
+  struct spinlock lock;   // protects dirty[]
+  uchar *data;
+  uint nblock;            // file system blocks in the image
+  uchar dirty[RDMAX/BSIZE/8];  // blocks written since the last sync
+} rd;
+
+// Mark blocks b..b+n-1 as written since the last sync.
+static void
+rdmark(uint b, uint n)
+{
+  acquire(&rd.lock);
+  for(; n > 0; b++, n--)
+    rd.dirty[b/8] |= 1 << (b%8);
+  release(&rd.lock);
+}
+
+static int
+rdstart(struct blkdev *d, struct buf *b, int n)
+{
+  uchar *p;
+
+  for(; b; b = b->qnext){
+    if(b->blockno >= rd.nblock)
+      panic("ramdisk: block out of range");
+    p = rd.data + b->blockno*BSIZE;
+    if(b->flags & B_DIRTY){
+      memmove(p, b->data, BSIZE);
+      rdmark(b->blockno, 1);
+    } else
+      memmove(b->data, p, BSIZE);
+  }
+  return 1;
+}
+
+static struct blkdev rddev = {
+  .name = "ramdisk",
+  .start = rdstart,
+  .maxmerge = 16,
+};
+
+// Look for a file system image at RDBASE and register it as
+// RDDEV.  Called before kinit2(), which must not hand out the
+// pages under it.  Return the number of bytes to keep, 0 if
+// there is no image.
+uint
+rdinit(void)
+{
+  struct superblock *sb;
+
+  initlock(&rd.lock, "ramdisk");
+  rd.data = p2v(RDBASE);
+  sb = (struct superblock*)(rd.data + BSIZE);
+  if(sb->bsize != BSIZE || sb->size == 0 || sb->size > RDMAX/BSIZE ||
+     sb->nblocks >= sb->size || sb->nlog >= sb->size || sb->ninodes == 0){
+    if(RDDEV == ROOTDEV)
+      panic("ramdisk: no root image");
+    return 0;
+  }
+  rd.nblock = sb->size;
+  rddev.size = rd.nblock * (BSIZE/SECTSIZE);
+  cprintf("ramdisk: %d blocks at %x\n", rd.nblock, RDBASE);
+  blkregister(RDDEV, &rddev);
+  return PGROUNDUP(rd.nblock * BSIZE);
+}
+
+#ifdef SEMIHOST
+#define SH_OPEN		0x01
+#define SH_CLOSE	0x02
+#define SH_WRITE	0x05
+#define SH_SEEK		0x0A
+#define SH_RPLUSB	3	// fopen() mode "r+b"
+
+// Make an ARM semihosting call; QEMU traps the SVC itself.
+static int
+semihost(int op, uint *args)
+{
+  register int r0 asm("r0") = op;
+  register uint *r1 asm("r1") = args;
+
+  asm volatile("svc 0x123456" : "+r"(r0) : "r"(r1) : "lr", "memory");
+  return r0;
+}
+
+// Write the runs of dirty blocks to the host's RDFILE.  A block
+// written again while this runs is marked dirty again, so the
+// next sync picks it up; so are the blocks of a failed write.
+static int
+rdwriteback(void)
+{
+  uint args[3], b, n;
+  int fd, err;
+
+  args[0] = (uint)RDFILE;
+  args[1] = SH_RPLUSB;
+  args[2] = sizeof(RDFILE) - 1;
+  if((fd = semihost(SH_OPEN, args)) < 0)
+    return -1;
+  err = 0;
+  for(b = 0; b < rd.nblock; b += n){
+    acquire(&rd.lock);
+    for(n = 0; b+n < rd.nblock && (rd.dirty[(b+n)/8] & (1 << ((b+n)%8))); n++)
+      rd.dirty[(b+n)/8] &= ~(1 << ((b+n)%8));
+    release(&rd.lock);
+    if(n == 0){
+      n = 1;
+      continue;
+    }
+    args[0] = fd;
+    args[1] = b*BSIZE;
+    if(semihost(SH_SEEK, args) == 0){
+      args[1] = (uint)(rd.data + b*BSIZE);
+      args[2] = n*BSIZE;
+      if(semihost(SH_WRITE, args) == 0)  // returns the bytes not written
+        continue;
+    }
+    rdmark(b, n);
+    err = -1;
+    break;
+  }
+  args[0] = fd;
+  semihost(SH_CLOSE, args);
+  return err;
+}
+#endif
+
+// Copy the blocks written since the last sync back to the image
+// the RAM disk came from.  Return 0, or -1 if they could not be
+// written back.
+int
+rdsync(void)
+{
+  if(rd.nblock == 0)
+    return 0;
+#ifdef SEMIHOST
+  return rdwriteback();
+#else
+  return -1;
+#endif
+}
@@ -0,0 +1,85 @@
+// Sleeping locks
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "arm.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+
+// A process waiting for a sleep lock.  Lives on the waiter's
+// kernel stack for as long as it is queued.
+struct slwaiter {
+  struct proc *proc;
+  struct slwaiter *next;
+  int granted;            // set by releasesleep on handoff
+};
+
+void
+initsleeplock(struct sleeplock *lk, char *name)
+{
+  initlock(&lk->lk, name);
+  lk->name = name;
+  lk->locked = 0;
+  lk->head = 0;
+  lk->tail = 0;
+  lk->pid = 0;
+}
+
+void
+acquiresleep(struct sleeplock *lk)
+{
+  struct slwaiter w;
+
+  acquire(&lk->lk);
+  if(lk->locked){
+    w.proc = curr_proc;
+    w.next = 0;
+    w.granted = 0;
+    if(lk->tail)
+      lk->tail->next = &w;
+    else
+      lk->head = &w;
+    lk->tail = &w;
+    // releasesleep leaves the lock held and hands it to us.
+    while(!w.granted)
+      sleep(&w, &lk->lk);
+  }
+  lk->locked = 1;
+  lk->pid = curr_proc->pid;
+  release(&lk->lk);
+}
+
+void
+releasesleep(struct sleeplock *lk)
+{
+  struct slwaiter *w;
+
+  acquire(&lk->lk);
+  if((w = lk->head) != 0){
+    lk->head = w->next;
+    if(lk->head == 0)
+      lk->tail = 0;
+    w->granted = 1;
+    lk->pid = w->proc->pid;
+    wakeproc(w->proc, w);
+  } else {
+    lk->locked = 0;
+    lk->pid = 0;
+  }
+  release(&lk->lk);
+}
+
+int
+holdingsleep(struct sleeplock *lk)
+{
+  int r;
+
+  acquire(&lk->lk);
+  r = lk->locked && lk->pid == curr_proc->pid;
+  release(&lk->lk);
+  return r;
+}
@@ -0,0 +1,13 @@
+// Long-term lock for processes.
+// Waiters queue in arrival order; on release the lock passes
+// directly to the first of them, so only one process is woken.
+struct sleeplock {
+  uint locked;            // Is the lock held?
+  struct spinlock lk;     // protects this sleep lock
+  struct slwaiter *head;  // queue of waiting processes
+  struct slwaiter *tail;
+
+  // For debugging:
+  char *name;             // Name of lock.
+  int pid;                // Process holding lock
+};
@@ -0,0 +1,140 @@
+// Softirqs: interrupt work deferred out of hard-IRQ context.
+//
+// An interrupt handler does only what the device needs at once
+// and calls raise_softirq() for the rest.  When trap() is done
+// with the interrupt it calls do_softirq(), which runs the
+// raised handlers with interrupts enabled.  If handlers keep
+// being raised, do_softirq() gives up after a few rounds and
+// leaves the rest to the ksoftirqd kernel thread, so the time
+// spent on the way out of an interrupt stays bounded.
+//
+// Softirq handlers may run on any cpu, and on two at once, but
+// never nested on one; they must not sleep.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "traps.h"
+#include "arm.h"
+#include "spinlock.h"
+
+#define MAXRESTART 4   // rounds per interrupt before ksoftirqd
+
+static struct {
+  struct spinlock lock;
+  uint pending;                   // raised, not yet run
+  void (*handler[NSOFTIRQ])(void);
+  struct proc *ksoftirqd;
+} softirq;
+
+void
+softirq_register(int n, void (*handler)(void))
+{
+  if(n < 0 || n >= NSOFTIRQ || softirq.handler[n])
+    panic("softirq_register");
+  softirq.handler[n] = handler;
+}
+
+// Ask for handler n to be run soon.  Safe in interrupt handlers.
+void
+raise_softirq(int n)
+{
+  acquire(&softirq.lock);
+  softirq.pending |= 1 << n;
+  release(&softirq.lock);
+}
+
+static uint
+takepending(void)
+{
+  uint pending;
+
+  acquire(&softirq.lock);
+  pending = softirq.pending;
+  softirq.pending = 0;
+  release(&softirq.lock);
+  return pending;
+}
+
+static void
+runsoftirqs(uint pending)
+{
+  int n;
+
+  while(pending){
+    n = 31 - clz(pending);
+    pending &= ~(1 << n);
+    softirq.handler[n]();
+  }
+}
+
+// Called by trap() at the end of an interrupt, with interrupts
+// off.  Runs the pending handlers with interrupts on; nested
+// interrupts leave them to this outer call.
+void
+do_softirq(void)
+{
+  struct cpu *c;
+  uint pending;
+  int i;
+
+  c = curr_cpu;
+  if(c->insoftirq || c->ncli > 0)
+    return;
+  c->insoftirq = 1;
+  for(i = 0; i < MAXRESTART; i++){
+    if((pending = takepending()) == 0)
+      break;
+    sti();
+    runsoftirqs(pending);
+    cli();
+  }
+  c->insoftirq = 0;
+
+  if(i == MAXRESTART && softirq.pending && softirq.ksoftirqd)
+    wakeproc(softirq.ksoftirqd, &softirq.pending);
+}
+
+// Runs whatever interrupt exits left over, as an ordinary
+// process that the scheduler can preempt between batches.
+// insoftirq keeps interrupt exits on this cpu from nesting
+// handlers inside ours, and trap() from preempting us.
+static void
+ksoftirqd(void)
+{
+  struct cpu *c;
+  uint pending;
+
+  for(;;){
+    acquire(&softirq.lock);
+    while(softirq.pending == 0)
+      sleep(&softirq.pending, &softirq.lock);
+    release(&softirq.lock);
+
+    pushcli();
+    c = curr_cpu;
+    c->insoftirq = 1;
+    popcli();
+    if((pending = takepending()) != 0)
+      runsoftirqs(pending);
+    pushcli();
+    c->insoftirq = 0;
+    popcli();
+  }
+}
+
+void
+softirqinit(void)
+{
+  initlock(&softirq.lock, "softirq");
+}
+
+// Start ksoftirqd; needs the process table.
+void
+softirqstart(void)
+{
+  softirq.ksoftirqd = kthread("ksoftirqd", ksoftirqd);
+}
@@ -15,6 +15,102 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "lockstat.h"
+
+#ifdef LOCKSTAT
+// Statistics are kept per lock class, that is per name given
+// to initlock, so that all pipes or all buffers add up to one
+// entry.  Each cpu updates its own copy; lockstats() sums them.
+struct lockclass {
+  char *name;
+  struct lockstat cpu[NCPU];
+};
+
+static struct lockclass lockclass[NLOCKCLASS];
+static int nlockclass;
+static struct spinlock classlock = { 0, "lockclass" };
+
+static struct lockclass*
+findclass(char *name)
+{
+  struct lockclass *c;
+
+  acquire(&classlock);
+  for(c = lockclass; c < &lockclass[nlockclass]; c++)
+    if(strncmp(c->name, name, sizeof(c->cpu[0].name)) == 0)
+      goto found;
+  if(nlockclass == NLOCKCLASS){
+    c = 0;
+    goto found;
+  }
+  c = &lockclass[nlockclass++];
+  c->name = name;
+found:
+  release(&classlock);
+  return c;
+}
+
+// Bucket i holds times in [2^(i-1), 2^i) us.
+static int
+histbucket(uint us)
+{
+  int i;
+
+  for(i = 0; us != 0 && i < NLOCKHIST-1; i++)
+    us >>= 1;
+  return i;
+}
+
+static void
+recordsite(struct lockstat *s, uint pc)
+{
+  int i, min;
+
+  min = 0;
+  for(i = 0; i < NLOCKSITE; i++){
+    if(s->sitepc[i] == pc){
+      s->sitecount[i]++;
+      return;
+    }
+    if(s->sitecount[i] < s->sitecount[min])
+      min = i;
+  }
+  // Replace the least used site; it inherits the count so a
+  // new hot caller can still climb past the others.
+  s->sitepc[min] = pc;
+  s->sitecount[min]++;
+}
+
+// Account for an acquire that spun for wait us (-1 if it did
+// not have to spin), called once the lock is held.
+static void
+lockstatacquire(struct spinlock *lk, int wait)
+{
+  struct lockstat *s;
+
+  s = &lk->class->cpu[curr_cpu->id];
+  s->nacquire++;
+  if(wait >= 0){
+    s->ncontended++;
+    s->waittime += wait;
+    s->waithist[histbucket(wait)]++;
+    recordsite(s, lk->pcs[0]);
+  }
+  lk->tacquire = getsystemtimelo();
+}
+
+static void
+lockstatrelease(struct spinlock *lk)
+{
+  struct lockstat *s;
+  uint held;
+
+  held = getsystemtimelo() - lk->tacquire;
+  s = &lk->class->cpu[curr_cpu->id];
+  s->holdtime += held;
+  s->holdhist[histbucket(held)]++;
+}
+#endif
 
 void
 initlock(struct spinlock *lk, char *name)
@@ -22,6 +118,10 @@ initlock(struct spinlock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+  lk->class = 0;
+#ifdef LOCKSTAT
+  lk->class = findclass(name);
+#endif
 }
 
 // Acquire the lock.
@@ -31,16 +131,46 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+#ifdef LOCKSTAT
+  uint t0;
+  int wait;
+#endif
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk)){
     cprintf("lock name: %s, locked: %d, cpu: %x CPSR: %x\n", lk->name, lk->locked, lk->cpu, readcpsr());
     panic("acquire");
   }
 
-  lk->locked = 1;
+  // The ldrex/strex exchange is atomic across cpus.
+#ifdef LOCKSTAT
+  wait = -1;
+  if(xchg(&lk->locked, 1) != 0){
+    t0 = getsystemtimelo();
+    while(xchg(&lk->locked, 1) != 0)
+      ;
+    wait = getsystemtimelo() - t0;
+  }
+#else
+  while(xchg(&lk->locked, 1) != 0)
+    ;
+#endif
+
+  // Tell the compiler and the processor not to move loads or
+  // stores past this point, so that the critical section's
+  // memory references happen after the lock is acquired.
+  dmb();
 
-  // Record info about lock acquisition for debugging.
+  // Record info about lock acquisition for debugging.  Only
+  // the profiler pays for walking the whole call stack.
   lk->cpu = curr_cpu;
+#ifdef LOCKSTAT
+  getcallerpcs(__builtin_frame_address(0), lk->pcs);
+  if(lk->class)
+    lockstatacquire(lk, wait);
+#else
+  lk->pcs[0] = (uint)__builtin_return_address(0);
+#endif
 }
 
 // Release the lock.
@@ -51,17 +181,86 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+#ifdef LOCKSTAT
+  if(lk->class)
+    lockstatrelease(lk);
+#endif
+
   lk->pcs[0] = 0;
   lk->cpu = 0;
 
+  // Make the critical section's stores visible to other cpus
+  // before the lock is seen to be free.
+  dmb();
   lk->locked = 0;
   popcli();
 }
 
-// Record the current call stack in pcs[] by following the %ebp chain.
+// Record the current call stack in pcs[] by following the
+// frame pointer chain from v, a value of __builtin_frame_address.
+// Each frame starts with {fp, lr} pushed by the prologue and fp
+// points at the saved lr, so fp[0] is the return address and
+// fp[-1] the caller's frame.  Kernel stacks grow down, so each
+// caller's frame must lie above the last.
 void
 getcallerpcs(void *v, uint pcs[])
 {
+  uint *fp;
+  int i;
+
+  fp = (uint*)v;
+  for(i = 0; i < 10; i++){
+    if(fp == 0 || (uint)fp < KERNBASE || ((uint)fp & 3))
+      break;
+    pcs[i] = fp[0];
+    fp = (uint*)fp[-1] > fp ? (uint*)fp[-1] : 0;
+  }
+  for(; i < 10; i++)
+    pcs[i] = 0;
+}
+
+// Copy up to n lock classes' statistics, summed over cpus,
+// to ls and return how many there were; -1 if the kernel
+// keeps none.
+int
+lockstats(struct lockstat *ls, int n)
+{
+#ifdef LOCKSTAT
+  struct lockstat *s;
+  int i, j, k, cpu;
+
+  acquire(&classlock);
+  if(n > nlockclass)
+    n = nlockclass;
+  release(&classlock);
+  memset(ls, 0, n*sizeof(*ls));
+  for(i = 0; i < n; i++){
+    safestrcpy(ls[i].name, lockclass[i].name, sizeof(ls[i].name));
+    for(cpu = 0; cpu < NCPU; cpu++){
+      s = &lockclass[i].cpu[cpu];
+      ls[i].nacquire += s->nacquire;
+      ls[i].ncontended += s->ncontended;
+      ls[i].waittime += s->waittime;
+      ls[i].holdtime += s->holdtime;
+      for(j = 0; j < NLOCKHIST; j++){
+        ls[i].waithist[j] += s->waithist[j];
+        ls[i].holdhist[j] += s->holdhist[j];
+      }
+      for(j = 0; j < NLOCKSITE && s->sitepc[j]; j++){
+        for(k = 0; k < NLOCKSITE; k++)
+          if(ls[i].sitepc[k] == s->sitepc[j] || ls[i].sitepc[k] == 0)
+            break;
+        if(k == NLOCKSITE)
+          continue;
+        ls[i].sitepc[k] = s->sitepc[j];
+        ls[i].sitecount[k] += s->sitecount[j];
+      }
+    }
+  }
+  return n;
+#else
+  return -1;
+#endif
 }
 
 
@@ -88,8 +287,13 @@ pushcli(void)
   uint cpsr;
   cpsr = readcpsr();
   cli();
-  if(curr_cpu->ncli++ == 0)
+  if(curr_cpu->ncli++ == 0){
     curr_cpu->intena = (cpsr & PSR_DISABLE_IRQ) ? 0: 1;
+#ifdef IRQTRACE
+    if(curr_cpu->intena)
+      traceclistart(__builtin_frame_address(0));
+#endif
+  }
 }
 
 void
@@ -99,7 +303,11 @@ popcli(void)
     panic("popcli - interruptible");
   if(--curr_cpu->ncli < 0)
     panic("popcli");
-  if(curr_cpu->ncli == 0 && curr_cpu->intena)
+  if(curr_cpu->ncli == 0 && curr_cpu->intena){
+#ifdef IRQTRACE
+    tracecliend();
+#endif
     sti();
+  }
 }
 
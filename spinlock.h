@@ -7,5 +7,9 @@ struct spinlock {
   struct cpu *cpu;   // The cpu holding the lock.
   uint pcs[10];      // The call stack (an array of program counters)
                      // that locked the lock.
+
+  // For lockstat (kernels built with LOCKSTAT=1):
+  struct lockclass *class; // statistics shared by locks of this name
+  uint tacquire;     // system timer when acquired
 };
 
@@ -0,0 +1,25 @@
+// System call tracing and statistics, returned by the
+// traceread() and sysstat() system calls.
+// Both the kernel and user programs use this header file.
+
+#define NSYSCALL   48   // system call numbers with statistics
+#define NSYSHIST   16   // log2 histogram buckets of microseconds
+#define NTRACEENT  256  // entries in the kernel's trace ring
+
+// One traced system call.
+struct traceent {
+  uint seq;           // position in the ring; gaps mean lost entries
+  int pid;
+  int num;            // system call number
+  uint args[4];
+  int ret;
+  uint usec;          // time in the kernel
+};
+
+// All calls of one system call, by every process.
+struct sysstat {
+  uint count;
+  uint time;          // total us
+  uint max;           // us
+  uint hist[NSYSHIST];  // bucket i: < 2^i us
+};
@@ -14,18 +14,22 @@
 #include "proc.h"
 #include "arm.h"
 #include "syscall.h"
+#include "spinlock.h"
+#include "strace.h"
 
-// User code makes a system call with INT T_SYSCALL.
-// System call number in %eax.
-// Arguments on the stack, from the user call to the C
-// library system call function. The saved user %esp points
-// to a saved program counter, and then the first argument.
+// User code makes a system call with SWI T_SYSCALL.
+// System call number in r7.
+// Arguments in r0-r5, as the user call to the C library
+// system call function left them (see usr/usys.S), so they
+// are read straight out of the trap frame.
 
 // Fetch the int at addr from the current process.
 int
 fetchint(uint addr, int *ip)
 {
-  if(addr >= curr_proc->sz || addr+4 > curr_proc->sz)
+  struct proc *curproc = curr_proc;
+
+  if(addr >= curproc->sz || addr+4 > curproc->sz)
     return -1;
   *ip = *(int*)(addr);
   return 0;
@@ -37,12 +41,13 @@ fetchint(uint addr, int *ip)
 int
 fetchstr(uint addr, char **pp)
 {
+  struct proc *curproc = curr_proc;
   char *s, *ep;
 
-  if(addr >= curr_proc->sz)
+  if(addr >= curproc->sz)
     return -1;
   *pp = (char*)addr;
-  ep = (char*)curr_proc->sz;
+  ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++)
     if(*s == 0)
       return s - *pp;
@@ -53,7 +58,10 @@ fetchstr(uint addr, char **pp)
 int
 argint(int n, int *ip)
 {
-  return fetchint(curr_proc->tf->sp + 4*n, ip);
+  if(n < 0 || n > 5)
+    return -1;
+  *ip = (&curr_proc->tf->r0)[n];
+  return 0;
 }
 
 // Fetch the nth word-sized system call argument as a pointer
@@ -62,11 +70,12 @@ argint(int n, int *ip)
 int
 argptr(int n, char **pp, int size)
 {
+  struct proc *curproc = curr_proc;
   int i;
   
   if(argint(n, &i) < 0)
     return -1;
-  if((uint)i >= curr_proc->sz || (uint)i+size > curr_proc->sz)
+  if((uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
   *pp = (char*)i;
   return 0;
@@ -106,6 +115,20 @@ extern int sys_unlink(void);
 extern int sys_wait(void);
 extern int sys_write(void);
 extern int sys_uptime(void);
+extern int sys_getprocs(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futexwait(void);
+extern int sys_futexwake(void);
+extern int sys_lockstat(void);
+extern int sys_irqstat(void);
+extern int sys_irqtrace(void);
+extern int sys_strace(void);
+extern int sys_traceread(void);
+extern int sys_sysstat(void);
+extern int sys_ringenter(void);
+extern int sys_iostat(void);
+extern int sys_sync(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -129,24 +152,161 @@ static int (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
+[SYS_getprocs] sys_getprocs,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futexwait] sys_futexwait,
+[SYS_futexwake] sys_futexwake,
+[SYS_lockstat] sys_lockstat,
+[SYS_irqstat] sys_irqstat,
+[SYS_irqtrace] sys_irqtrace,
+[SYS_strace]  sys_strace,
+[SYS_traceread] sys_traceread,
+[SYS_sysstat] sys_sysstat,
+[SYS_ringenter] sys_ringenter,
+[SYS_iostat]  sys_iostat,
+[SYS_sync]    sys_sync,
 };
 
+// Calls made by processes with the call's bit set in their
+// tracemask go into a ring that traceread() empties.  When the
+// ring is full the oldest entries are overwritten; the reader
+// sees the gap in seq.
+static struct {
+  struct spinlock lock;
+  struct traceent ring[NTRACEENT];
+  uint head;            // seq of the oldest entry
+  uint tail;            // seq of the next entry
+} trace;
+
+// Every call is counted here; each cpu has its own copy.
+static struct sysstat sysstats[NCPU][NSYSCALL];
+
+void
+syscallinit(void)
+{
+  initlock(&trace.lock, "strace");
+}
+
+static int
+traced(struct proc *p, int num)
+{
+  return num < NSYSCALL && (p->tracemask[num/32] & (1 << (num%32)));
+}
+
+static void
+tracelog(int num, uint *args, int ret, uint usec)
+{
+  struct traceent *e;
+
+  acquire(&trace.lock);
+  e = &trace.ring[trace.tail % NTRACEENT];
+  e->seq = trace.tail++;
+  e->pid = curr_proc->pid;
+  e->num = num;
+  memmove(e->args, args, sizeof(e->args));
+  e->ret = ret;
+  e->usec = usec;
+  if(trace.tail - trace.head > NTRACEENT)
+    trace.head = trace.tail - NTRACEENT;
+  release(&trace.lock);
+}
+
+// Copy up to n trace entries to buf, oldest first, and remove
+// them from the ring.  Return how many were copied.
+int
+traceread(struct traceent *buf, int n)
+{
+  int i;
+
+  acquire(&trace.lock);
+  for(i = 0; i < n && trace.head != trace.tail; i++)
+    buf[i] = trace.ring[trace.head++ % NTRACEENT];
+  release(&trace.lock);
+  return i;
+}
+
+static void
+sysaccount(int num, uint usec)
+{
+  struct sysstat *s;
+  int i;
+
+  if(num >= NSYSCALL)
+    return;
+  pushcli();
+  s = &sysstats[curr_cpu->id][num];
+  s->count++;
+  s->time += usec;
+  if(usec > s->max)
+    s->max = usec;
+  for(i = 0; usec >> i && i < NSYSHIST-1; i++)
+    ;
+  s->hist[i]++;
+  popcli();
+}
+
+// Copy the statistics of the first n system calls, summed over
+// cpus, to st.  Return how many were copied.
+int
+sysstatcopy(struct sysstat *st, int n)
+{
+  struct sysstat *s;
+  int num, cpu, i;
+
+  if(n > NSYSCALL)
+    n = NSYSCALL;
+  memset(st, 0, n*sizeof(*st));
+  for(num = 0; num < n; num++){
+    for(cpu = 0; cpu < NCPU; cpu++){
+      s = &sysstats[cpu][num];
+      st[num].count += s->count;
+      st[num].time += s->time;
+      if(s->max > st[num].max)
+        st[num].max = s->max;
+      for(i = 0; i < NSYSHIST; i++)
+        st[num].hist[i] += s->hist[i];
+    }
+  }
+  return n;
+}
+
 void
 syscall(void)
 {
-  int num;
+  struct proc *curproc = curr_proc;
+  int num, i, ret, tr;
+  uint args[4], t0, usec;
 
-  num = curr_proc->tf->r0;
+  num = curproc->tf->r7;
+  curproc->nsyscall++;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
 //    cprintf("\n%d %s: sys call %d syscall address %x\n",
-//            curr_proc->pid, curr_proc->name, num, syscalls[num]);
+//            curproc->pid, curproc->name, num, syscalls[num]);
+    if((tr = traced(curproc, num)) != 0)
+      for(i = 0; i < 4; i++)
+        if(argint(i, (int*)&args[i]) < 0)
+          args[i] = 0;
+    if(num == SYS_exit){
+      // Does not return.
+      sysaccount(num, 0);
+      if(tr)
+        tracelog(num, args, 0, 0);
+    }
 
+    t0 = getsystemtimelo();
     if(num == SYS_exec) {
-	if(syscalls[num]() == -1) curr_proc->tf->r0 = -1;
-    } else curr_proc->tf->r0 = syscalls[num]();
+	if(syscalls[num]() == -1) curproc->tf->r0 = -1;
+    } else curproc->tf->r0 = syscalls[num]();
+    usec = getsystemtimelo() - t0;
+    ret = curproc->tf->r0;
+
+    sysaccount(num, usec);
+    if(tr)
+      tracelog(num, args, ret, usec);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
-            curr_proc->pid, curr_proc->name, num);
-    curr_proc->tf->r0 = -1;
+            curproc->pid, curproc->name, num);
+    curproc->tf->r0 = -1;
   }
 }
@@ -20,3 +20,17 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
+#define SYS_getprocs 22
+#define SYS_clone  23
+#define SYS_join   24
+#define SYS_futexwait 25
+#define SYS_futexwake 26
+#define SYS_lockstat 27
+#define SYS_irqstat 28
+#define SYS_irqtrace 29
+#define SYS_strace 30
+#define SYS_traceread 31
+#define SYS_sysstat 32
+#define SYS_ringenter 33
+#define SYS_iostat 34
+#define SYS_sync   35
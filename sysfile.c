@@ -11,8 +11,11 @@
 #include "mmu.h"
 #include "proc.h"
 #include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "uring.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -277,16 +280,14 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-int
-sys_open(void)
+// Open path and return a new file descriptor for it, or -1.
+static int
+openpath(char *path, int omode)
 {
-  char *path;
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
-    return -1;
   if(omode & O_CREATE){
     begin_trans();
     ip = create(path, T_FILE, 0, 0);
@@ -319,6 +320,17 @@ sys_open(void)
   return fd;
 }
 
+int
+sys_open(void)
+{
+  char *path;
+  int omode;
+
+  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return openpath(path, omode);
+}
+
 int
 sys_mkdir(void)
 {
@@ -424,3 +436,74 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// Run one queued operation, checking its arguments as the
+// system call itself would.
+static int
+ringop(struct sqe *e)
+{
+  struct file *f;
+  char *path;
+
+  if(e->op == RING_NOP)
+    return 0;
+  if(e->op == RING_OPEN){
+    if(fetchstr(e->addr, &path) < 0)
+      return -1;
+    return openpath(path, e->n);
+  }
+  if(e->fd < 0 || e->fd >= NOFILE || (f = curr_proc->ofile[e->fd]) == 0)
+    return -1;
+  switch(e->op){
+  case RING_READ:
+  case RING_WRITE:
+    if(e->n < 0 || e->addr >= curr_proc->sz || e->addr+e->n > curr_proc->sz)
+      return -1;
+    if(e->op == RING_READ)
+      return fileread(f, (char*)e->addr, e->n);
+    return filewrite(f, (char*)e->addr, e->n);
+  case RING_CLOSE:
+    curr_proc->ofile[e->fd] = 0;
+    fileclose(f);
+    return 0;
+  }
+  return -1;
+}
+
+// Run the operations queued in a struct uring, in order, for
+// the cost of one trap.  Stop early when the completion queue
+// is full.  Return the number of operations run.
+int
+sys_ringenter(void)
+{
+  struct uring *r;
+  struct sqe e;
+  uint head, tail;
+  int n;
+
+  if(argptr(0, (void*)&r, sizeof(*r)) < 0)
+    return -1;
+  // Work on private copies: other threads share the ring.
+  head = r->sqhead;
+  tail = r->sqtail;
+  if(tail - head > NRING)
+    return -1;
+  for(n = 0; head != tail && !curr_proc->killed; n++){
+    if(r->cqtail - r->cqhead >= NRING)
+      break;
+    e = r->sq[head % NRING];
+    r->cq[r->cqtail % NRING].tag = e.tag;
+    r->cq[r->cqtail % NRING].res = ringop(&e);
+    r->cqtail++;
+    r->sqhead = ++head;
+  }
+  return n;
+}
+
+// Commit the log and write the RAM disk back to its image.
+int
+sys_sync(void)
+{
+  logflush();
+  return rdsync();
+}
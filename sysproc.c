@@ -5,6 +5,12 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "pstat.h"
+#include "lockstat.h"
+#include "irqstat.h"
+#include "irqtrace.h"
+#include "strace.h"
+#include "iostat.h"
 
 int
 sys_fork(void)
@@ -88,3 +94,158 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// fill a user array with per-process statistics;
+// returns the number of entries used.
+int
+sys_getprocs(void)
+{
+  struct pstat *ps;
+  int max;
+
+  if(argint(1, &max) < 0 || max < 0 || max > NPROC)
+    return -1;
+  if(argptr(0, (char**)&ps, max*sizeof(*ps)) < 0)
+    return -1;
+  return getprocs(ps, max);
+}
+
+// copy lock contention statistics to user space
+int
+sys_lockstat(void)
+{
+  struct lockstat *ls;
+  int max;
+
+  if(argint(1, &max) < 0 || max < 0 || max > NLOCKCLASS)
+    return -1;
+  if(argptr(0, (char**)&ls, max*sizeof(*ls)) < 0)
+    return -1;
+  return lockstats(ls, max);
+}
+
+// copy per-interrupt statistics to user space
+int
+sys_irqstat(void)
+{
+  struct irqstat *st;
+  int max;
+
+  if(argint(1, &max) < 0 || max < 0 || max > NIRQ)
+    return -1;
+  if(argptr(0, (char**)&st, max*sizeof(*st)) < 0)
+    return -1;
+  return irqstatcopy(st, max);
+}
+
+// copy interrupt latency statistics to user space,
+// clearing them if the second argument is set
+int
+sys_irqtrace(void)
+{
+#ifdef IRQTRACE
+  struct irqtrace *t;
+  int reset;
+
+  if(argint(1, &reset) < 0)
+    return -1;
+  if(argptr(0, (char**)&t, NTRACE*sizeof(*t)) < 0)
+    return -1;
+  irqtracecopy(t, reset);
+  return NTRACE;
+#else
+  return -1;
+#endif
+}
+
+// trace the system calls in a mask (two words, bit n for
+// call n) made by a process and its new children
+int
+sys_strace(void)
+{
+  int pid, lo, hi;
+
+  if(argint(0, &pid) < 0 || argint(1, &lo) < 0 || argint(2, &hi) < 0)
+    return -1;
+  return settrace(pid, lo, hi);
+}
+
+// take entries out of the system call trace ring
+int
+sys_traceread(void)
+{
+  struct traceent *buf;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NTRACEENT)
+    return -1;
+  if(argptr(0, (char**)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  return traceread(buf, n);
+}
+
+// copy per-system-call statistics to user space
+int
+sys_sysstat(void)
+{
+  struct sysstat *st;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NSYSCALL)
+    return -1;
+  if(argptr(0, (char**)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return sysstatcopy(st, n);
+}
+
+// start a thread running fn(arg) on the given user stack
+int
+sys_clone(void)
+{
+  int fn, arg, stack;
+
+  if(argint(0, &fn) < 0 || argint(1, &arg) < 0 || argint(2, &stack) < 0)
+    return -1;
+  return clone(fn, arg, stack);
+}
+
+int
+sys_join(void)
+{
+  return join();
+}
+
+// sleep while the word at addr holds val
+int
+sys_futexwait(void)
+{
+  int addr, val;
+
+  if(argint(0, &addr) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futexwait(addr, val);
+}
+
+// wake up to n waiters on the word at addr
+int
+sys_futexwake(void)
+{
+  int addr, n;
+
+  if(argint(0, &addr) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futexwake(addr, n);
+}
+
+// copy the buffer cache and block device statistics to user space
+int
+sys_iostat(void)
+{
+  struct iostat *st;
+
+  if(argptr(0, (char**)&st, sizeof(*st)) < 0)
+    return -1;
+  bstat(st);
+  blkstat(st);
+  return 0;
+}
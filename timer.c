@@ -15,8 +15,9 @@
 #include "traps.h"
 #include "arm.h"
 #include "spinlock.h"
+#include "vdso.h"
 
-#define TIMER_REGS_BASE		0xFE003000
+#define TIMER_REGS_BASE		SYSTIMER
 #define CONTROL_STATUS		0x0 // control/status
 #define COUNTER_LO		0x4 // the time-stamp lower 32 bits
 #define COUNTER_HI		0x8 // the time-stamp higher 32 bits
@@ -27,22 +28,20 @@
 
 #define TIMER_FREQ		10000  // interrupt 100 times/sec.
 
-void 
-enabletimer3irq(void)
+// Wake sleep() callers, with interrupts on.
+static void
+timersoftirq(void)
 {
-        intctrlregs *ip;
-
-        ip = (intctrlregs *)INT_REGS_BASE;
-        ip->gpuenable[0] |= 1 << IRQ_TIMER3; // enable the system timer3 irq
+	wakeup(&ticks);
 }
 
-
 void 
 timer3init(void)
 {
 uint v;
 
-	enabletimer3irq();
+	softirq_register(SOFTIRQ_TIMER, timersoftirq);
+	irq_register(IRQ_TIMER3, timer3intr, 0);
 
 	v = inw(TIMER_REGS_BASE+COUNTER_LO);
 	v += TIMER_FREQ;
@@ -52,14 +51,17 @@ uint v;
 }
 
 void 
-timer3intr(void)
+timer3intr(void *arg)
 {
 uint v;
 //cprintf("timer3 interrupt: %x\n", inw(TIMER_REGS_BASE+CONTROL_STATUS));
 	outw(TIMER_REGS_BASE+CONTROL_STATUS, (1 << IRQ_TIMER3)); // clear timer3 irq
 
+	acquire(&tickslock);
 	ticks++;
-	wakeup(&ticks);
+	vdso->ticks = ticks;
+	release(&tickslock);
+	raise_softirq(SOFTIRQ_TIMER);	// wakeup scans the ptable
 
 	// reset the value of compare3
 	v=inw(TIMER_REGS_BASE+COUNTER_LO);
@@ -67,6 +69,53 @@ uint v;
 	outw(TIMER_REGS_BASE+COMPARE3, v);
 }
 
+#ifdef RPI2
+// The system timer only interrupts cpu 0, which keeps ticks.
+// The other cores preempt on their own generic timer (the
+// virtual timer), routed through the BCM2836 local block.
+#define CORE_TIMER_IRQCNTL(n)	(LOCALSPACE + 0x40 + 4*(n))
+#define CORE_IRQ_PENDING(n)	(LOCALSPACE + 0x60 + 4*(n))
+#define CNTVIRQ			(1 << 3)
+
+static uint cntfrq;
+
+static void
+localtimerreset(void)
+{
+	// same period as timer3: TIMER_FREQ us of the 1MHz clock
+	asm volatile("mcr p15, 0, %0, c14, c3, 0" : : "r"(cntfrq / (1000000 / TIMER_FREQ)));
+}
+
+void
+localtimerinit(void)
+{
+	asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(cntfrq));
+	if(cntfrq == 0)
+		cntfrq = 19200000; // what the firmware normally sets
+	localtimerreset();
+	asm volatile("mcr p15, 0, %0, c14, c3, 1" : : "r"(1)); // enable
+	outw(CORE_TIMER_IRQCNTL(curr_cpu->id), CNTVIRQ);
+}
+
+// Return 1 if this cpu's timer interrupted.
+int
+localtimerintr(void)
+{
+	if((inw(CORE_IRQ_PENDING(curr_cpu->id)) & CNTVIRQ) == 0)
+		return 0;
+	localtimerreset();
+	return 1;
+}
+#endif
+
+// The low word of the 1MHz system timer, for timing short
+// intervals; differences are right across a wrap.
+uint
+getsystemtimelo(void)
+{
+	return inw(TIMER_REGS_BASE+COUNTER_LO);
+}
+
 void
 delay(uint m)
 {
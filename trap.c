@@ -55,7 +55,6 @@ void disable_intrs(void)
 void tvinit(void)
 {
 	uint *d, *s;
-	char *ptr;
 
 	/* initialize the exception vectors */
 	d = (uint *)HVECTORS;
@@ -68,6 +67,16 @@ void tvinit(void)
 	 */
 	dsb_barrier();
 	flush_idcache();
+	modestackinit();
+	initlock(&tickslock, "time");
+}
+
+/* Give this cpu's exception modes their stacks; they are banked
+ * per cpu, so every cpu calls this as it boots. */
+void modestackinit(void)
+{
+	char *ptr;
+
 	ptr = kalloc();
 	memset(ptr, 0, PGSIZE);
 	set_mode_sp(ptr+4096, 0xD1);/* fiq mode, fiq and irq are disabled */
@@ -101,64 +110,65 @@ cprintf("More registers: r6: %x, r7: %x, r8: %x, r9: %x, r10: %x, r11: %x, r12:
 //NotOkLoop();
 }
 
-void handle_irq(struct trapframe *tf)
-{
-	intctrlregs *ip;
-
-/*cprintf("trapno: %x, spsr: %x, sp: %x, lr: %x cpsr: %x ifar: %x\n", tf->trapno, tf->spsr, tf->sp, tf->pc, tf->cpsr, tf->ifar);
-cprintf("Saved registers: r0: %x, r1: %x, r2: %x, r3: %x, r4: %x, r5: %x, r6: %x\n", tf->r0, tf->r1, tf->r2, tf->r3, tf->r4, tf->r5, tf->r6);
-cprintf("More registers: r6: %x, r7: %x, r8: %x, r9: %x, r10: %x, r11: %x, r12: %x, r13: %x, r14: %x\n", tf->r7, tf->r8, tf->r9, tf->r10, tf->r11, tf->r12, tf->r13, tf->r14);
-*/
-	ip = (intctrlregs *)INT_REGS_BASE;
-	while(ip->gpupending[0] || ip->gpupending[1] || ip->armpending){
-	    if(ip->gpupending[0] & (1 << 3)) {
-		timer3intr();
-	    }
-	    if(ip->gpupending[0] & (1 << 29)) {
-		miniuartintr();
-	    }
-	}
-
-}
-
-
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
 {
-	intctrlregs *ip;
-	uint istimer;
+	uint istimer, n;
+	struct proc *p;
+
+	p = curr_cpu->proc;  // interrupts are still off from the exception
 
 //cprintf("Trap %d from cpu %d eip %x (cr2=0x%x)\n",
 //              tf->trapno, curr_cpu->id, tf->eip, 0);
   //trap_oops(tf);
   if(tf->trapno == T_SYSCALL){
-    if(curr_proc->killed)
+    if(p->killed)
       exit();
-    curr_proc->tf = tf;
+    p->tf = tf;
     syscall();
-    if(curr_proc->killed)
+    if(p->killed)
       exit();
     return;
   }
 
+  // The first VFP instruction since a switch is undefined.
+  if(tf->trapno == T_UND && p && (tf->spsr&0xF) == USER_MODE && vfptrap(tf))
+    return;
+
   istimer = 0;
   switch(tf->trapno){
   case T_IRQ:
-	ip = (intctrlregs *)INT_REGS_BASE;
-	while(ip->gpupending[0] || ip->gpupending[1] || ip->armpending){
-	    if(ip->gpupending[0] & (1 << IRQ_TIMER3)) {
-		istimer = 1;
-		timer3intr();
-	    }
-	    if(ip->gpupending[0] & (1 << IRQ_MINIUART)) {
-		miniuartintr();
-	    }
+#ifdef IRQTRACE
+	traceirqentry();
+#endif
+	// Device interrupts are only routed to cpu 0.
+	if(curr_cpu->id == 0){
+	    n = irqcount(IRQ_TIMER3);
+	    handle_irq();
+	    istimer = irqcount(IRQ_TIMER3) != n;
 	}
-
+#ifdef RPI2
+	else if(localtimerintr())
+	    istimer = 1;
+#endif
+
+	// Charge the tick to whoever it interrupted.
+	if(istimer && p){
+	    if((tf->spsr&0xF) == USER_MODE)
+		p->utime++;
+	    else
+		p->stime++;
+	}
+#ifdef IRQTRACE
+	traceirqexit();
+#endif
+	do_softirq();
 	break;
   default:
-    if(curr_proc == 0 || (tf->spsr & 0xF) != USER_MODE){
+    if(p && (tf->trapno == T_DABT || tf->trapno == T_PABT))
+      p->npgfault++;
+    if(p == 0 || (tf->spsr & 0xF) != USER_MODE){
       // In kernel, it must be our mistake.
       cprintf("unexpected trap %d from cpu %d addr %x spsr %x cpsr %x ifar %x\n",
               tf->trapno, curr_cpu->id, tf->pc, tf->spsr, tf->cpsr, tf->ifar);
@@ -167,31 +177,32 @@ trap(struct trapframe *tf)
     // In user space, assume process misbehaved.
     cprintf("pid %d %s: trap %d on cpu %d "
             "addr 0x%x spsr 0x%x cpsr 0x%x ifar 0x%x--kill proc\n",
-            curr_proc->pid, curr_proc->name, tf->trapno, curr_cpu->id, tf->pc,
+            p->pid, p->name, tf->trapno, curr_cpu->id, tf->pc,
             tf->spsr, tf->cpsr, tf->ifar);
-    curr_proc->killed = 1;
+    p->killed = 1;
   }
 
   // Force process exit if it has been killed and is in user space.
   // (If it is still executing in the kernel, let it keep running
   // until it gets to the regular system call return.)
 
-//cprintf("Proc pointer: %d\n", curr_proc);
-  if(curr_proc){
-        if(curr_proc->killed && (tf->spsr&0xF) == USER_MODE)
+//cprintf("Proc pointer: %d\n", p);
+  if(p){
+        if(p->killed && (tf->spsr&0xF) == USER_MODE)
                 exit();
 
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
-        if(curr_proc->state == RUNNING && istimer)
+  // Not while running softirqs, which must stay on this cpu.
+        if(p->state == RUNNING && istimer && !curr_cpu->insoftirq)
                 yield();
 
   // Check if the process has been killed since we yielded
-        if(curr_proc->killed && (tf->spsr&0xF) == USER_MODE)
+        if(p->killed && (tf->spsr&0xF) == USER_MODE)
                 exit();
   }
 
-//cprintf("Proc pointer: %d after\n", curr_proc);
+//cprintf("Proc pointer: %d after\n", p);
 
 }
 
@@ -17,5 +17,11 @@
 
 #define IRQ_TIMER3	3
 #define IRQ_MINIUART	29
+#define IRQ_EMMC	62
+
+// Softirqs: interrupt work deferred until interrupts are back on.
+#define NSOFTIRQ	8
+#define SOFTIRQ_TIMER	0	// wake sleep() callers
+#define SOFTIRQ_KBD	1	// keyboard line discipline
 
 #define INT_REGS_BASE 	(DEVSPACE+0xB200)
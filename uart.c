@@ -12,6 +12,7 @@
 #include "memlayout.h"
 #include "traps.h"
 #include "arm.h"
+#include "spinlock.h"
 
 #define GPFSEL0			0xFE200000
 #define GPFSEL1			0xFE200004
@@ -100,19 +101,57 @@ uartgetc(void)
 	else return -1;
 }
 
+// Characters taken from the uart by the interrupt handler,
+// waiting for the keyboard softirq.
+#define UARTRING 128
+
+static struct {
+  struct spinlock lock;
+  uchar buf[UARTRING];
+  uint r, w;
+} uartring;
+
+static int
+uartringgetc(void)
+{
+  int c;
+
+  acquire(&uartring.lock);
+  c = -1;
+  if(uartring.r != uartring.w)
+    c = uartring.buf[uartring.r++ % UARTRING];
+  release(&uartring.lock);
+  return c;
+}
+
+// Line discipline, run with interrupts on.
+static void
+uartsoftirq(void)
+{
+  uartkbdintr(uartringgetc);
+}
+
 void 
 enableirqminiuart(void)
 {
-  intctrlregs *ip;
-  ip = (intctrlregs *)INT_REGS_BASE;
-  ip->gpuenable[0] |= (1 << 29);   // enable the miniuart through Aux
+  initlock(&uartring.lock, "uartring");
+  softirq_register(SOFTIRQ_KBD, uartsoftirq);
+  irq_register(IRQ_MINIUART, miniuartintr, 0);   // the miniuart, through Aux
 }
 
 
+// Empty the uart's fifo into the ring; drop what doesn't fit.
 void
-miniuartintr(void)
+miniuartintr(void *arg)
 {
-  uartkbdintr(uartgetc);
+  int c;
+
+  acquire(&uartring.lock);
+  while((c = uartgetc()) >= 0)
+    if(uartring.w - uartring.r < UARTRING)
+      uartring.buf[uartring.w++ % UARTRING] = c;
+  release(&uartring.lock);
+  raise_softirq(SOFTIRQ_KBD);
 }
 
 void ___puts(const char *s)
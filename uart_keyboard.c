@@ -10,6 +10,7 @@
 #include "param.h"
 #include "spinlock.h"
 #include "fs.h"        // struct inode
+#include "sleeplock.h"
 #include "file.h"      // devsw[]
 #include "proc.h"      // sleep(), wakeup(), killed
 
@@ -26,7 +27,7 @@ static struct {
 
 
 /*
- * Called from UART interrupt handler
+ * Called from the keyboard softirq
  */
 void
 uartkbdintr(int (*getc)(void))
@@ -75,7 +76,7 @@ uartkbdintr(int (*getc)(void))
  * Read interface for /dev/uart_keyboard
  */
 int
-uartkbdread(struct inode *ip, char *dst, int n)
+uartkbdread(struct inode *ip, char *dst, uint off, int n)
 {
   uint target;
   int c;
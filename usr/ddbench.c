@@ -0,0 +1,89 @@
+// ddbench: sequential read (and write) throughput of a raw
+// disk, through the raw disk device.
+//   ddbench [-w] [disk [kbytes]]    defaults: disk 2 (the SD card), 4096KB
+// It reads kbytes from the start of the disk and, with -w,
+// then overwrites the kbytes after them, which must clear the
+// file system at the start of the disk: kbytes at least 4096,
+// the size of a 1024-block file system of 4KB blocks.
+// Blocks stay in the buffer cache, so only the first run after
+// boot measures the disk.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "file.h"
+
+#define CHUNK (32*1024)
+
+char buf[CHUNK];
+char path[] = "/dev/diskN";
+
+// Move kb KB through fd in CHUNK pieces; return the elapsed
+// microseconds, or 0 if the disk ended first.
+static uint
+run(int fd, int kb, int towrite)
+{
+  uint start;
+  int n, done;
+
+  start = vclock();
+  for(done = 0; done < kb*1024; done += n){
+    n = kb*1024 - done;
+    if(n > CHUNK)
+      n = CHUNK;
+    if((towrite ? write(fd, buf, n) : read(fd, buf, n)) != n)
+      return 0;
+  }
+  return vclock() - start;
+}
+
+static void
+report(char *what, int kb, uint us)
+{
+  uint ms;
+
+  if(us == 0){
+    printf(1, "%s: disk ends before %dKB\n", what, kb);
+    return;
+  }
+  ms = us / 1000;
+  if(ms == 0)
+    ms = 1;
+  printf(1, "%s: %dKB in %d ms, %d KB/s\n", what, kb, ms, kb * 1000 / ms);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, disk, kb, wr;
+
+  wr = argc > 1 && strcmp(argv[1], "-w") == 0;
+  if(wr){
+    argc--;
+    argv++;
+  }
+  disk = argc > 1 ? atoi(argv[1]) : 2;
+  kb = argc > 2 ? atoi(argv[2]) : 4096;
+  if(disk < 1 || disk > 9 || kb <= 0 || (wr && kb < 4096)){
+    printf(2, "usage: ddbench [-w] [disk [kbytes]]; -w needs kbytes >= 4096\n");
+    exit();
+  }
+
+  path[sizeof(path) - 2] = '0' + disk;
+  if((fd = open(path, O_RDWR)) < 0){
+    mknod(path, DISK, disk);
+    fd = open(path, O_RDWR);
+  }
+  if(fd < 0){
+    printf(2, "ddbench: cannot open %s\n", path);
+    exit();
+  }
+
+  report("read", kb, run(fd, kb, 0));
+  if(wr){
+    memset(buf, 0xA5, sizeof(buf));
+    report("write", kb, run(fd, kb, 1));
+  }
+  close(fd);
+  exit();
+}
@@ -31,8 +31,8 @@ struct inode {
 // table mapping major device number to
 // device functions
 struct devsw {
-  int (*read)(struct inode*, char*, int);
-  int (*write)(struct inode*, char*, int);
+  int (*read)(struct inode*, char*, uint, int);
+  int (*write)(struct inode*, char*, uint, int);
 };
 
 extern struct devsw devsw[];
@@ -40,3 +40,4 @@ extern struct devsw devsw[];
 #define CONSOLE 1
 #define UART_KEYBOARD 2
 #define FRAMEBUFFER 3
+#define DISK 4          // raw block device; minor is the device
@@ -0,0 +1,61 @@
+// fpbench: time the same floating point code built for software
+// floating point and for the VFP unit, then run the VFP version
+// in several processes at once to check that the kernel keeps
+// their registers apart.
+//   fpbench [iterations]    default 20
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NPROC 3   // processes sharing the VFP unit
+
+double fpkern_soft(int);
+double fpkern_vfp(int);
+
+int
+main(int argc, char *argv[])
+{
+  int iters, i, pid, fd[2], bad, ts, tv;
+  double s, v, r;
+
+  iters = argc > 1 ? atoi(argv[1]) : 20;
+
+  ts = uptime();
+  s = fpkern_soft(iters);
+  ts = uptime() - ts;
+  tv = uptime();
+  v = fpkern_vfp(iters);
+  tv = uptime() - tv;
+  printf(1, "soft float: %d ticks, checksum %d\n", ts, (int)s);
+  printf(1, "vfp:        %d ticks, checksum %d\n", tv, (int)v);
+  if(tv == 0)
+    tv = 1;
+  printf(1, "speedup %d.%d\n", ts / tv, (ts * 10 / tv) % 10);
+
+  if(pipe(fd) < 0){
+    printf(2, "fpbench: pipe failed\n");
+    exit();
+  }
+  for(i = 0; i < NPROC; i++){
+    if((pid = fork()) < 0){
+      printf(2, "fpbench: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      close(fd[0]);
+      r = fpkern_vfp(iters);
+      write(fd[1], &r, sizeof(r));
+      exit();
+    }
+  }
+  close(fd[1]);
+  bad = 0;
+  for(i = 0; i < NPROC; i++){
+    if(read(fd[0], &r, sizeof(r)) != sizeof(r) || r != v)
+      bad++;
+    wait();
+  }
+  close(fd[0]);
+  printf(1, "%d processes sharing the vfp: %s\n", NPROC, bad ? "MISMATCH" : "ok");
+  exit();
+}
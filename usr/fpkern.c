@@ -0,0 +1,50 @@
+// The floating point work timed by fpbench.  The Makefile
+// builds this file twice, as fpkern_soft() with the default
+// software floating point and as fpkern_vfp() for the VFP unit.
+#include "types.h"
+
+#define N     24   // matrix size
+#define MAXIT 64   // mandelbrot iterations per point
+
+// Multiply two N x N matrices and walk a small mandelbrot
+// grid, iters times; return a checksum of the results.
+double
+FPKERN(int iters)
+{
+  static double a[N][N], b[N][N], c[N][N];
+  double sum, x, y, zx, zy, t;
+  int i, j, k, n, px, py;
+
+  for(i = 0; i < N; i++)
+    for(j = 0; j < N; j++){
+      a[i][j] = (i + 1) * 0.5 - j * 0.25;
+      b[i][j] = (j + 1) * 0.125 + i * 0.75;
+    }
+
+  sum = 0;
+  for(n = 0; n < iters; n++){
+    for(i = 0; i < N; i++)
+      for(j = 0; j < N; j++){
+        t = 0;
+        for(k = 0; k < N; k++)
+          t += a[i][k] * b[k][j];
+        c[i][j] = t;
+      }
+    sum += c[n % N][(n * 7) % N];
+
+    for(py = 0; py < 16; py++){
+      for(px = 0; px < 32; px++){
+        x = -2.0 + px * (3.0 / 32);
+        y = -1.0 + py * (2.0 / 16);
+        zx = zy = 0;
+        for(k = 0; k < MAXIT && zx*zx + zy*zy < 4.0; k++){
+          t = zx*zx - zy*zy + x;
+          zy = 2*zx*zy + y;
+          zx = t;
+        }
+        sum += k;
+      }
+    }
+  }
+  return sum;
+}
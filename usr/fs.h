@@ -9,7 +9,10 @@
 // Then sb.nlog log blocks.
 
 #define ROOTINO 1  // root i-number
-#define BSIZE 512  // block size
+#ifndef BSIZE
+#define BSIZE 512  // block size: 512, 1024, 2048 or 4096 (make BSIZE=)
+#endif
+#define SECTSIZE 512  // disk sector size
 
 // File system super block
 struct superblock {
@@ -17,6 +20,7 @@ struct superblock {
   uint nblocks;      // Number of data blocks
   uint ninodes;      // Number of inodes.
   uint nlog;         // Number of log blocks
+  uint bsize;        // Block size (bytes)
 };
 
 #define NDIRECT 12
@@ -0,0 +1,134 @@
+// iostat: buffer cache and block device statistics.
+//   iostat              totals since boot
+//   iostat cmd [args]   only what happened while cmd ran
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "iostat.h"
+
+struct iostat before, after;
+
+// Print x right-aligned in a field of width w.
+static void
+padint(uint x, int w)
+{
+  char buf[12];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = 0;
+  do{
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  }while(x && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf(1, "%s ", buf + i);
+}
+
+// Subtract the before snapshot from the after one.
+static void
+subtract(struct iostat *a, struct iostat *b)
+{
+  struct iodev *x, *y;
+  int i;
+
+  a->hits -= b->hits;
+  a->misses -= b->misses;
+  a->readahead -= b->readahead;
+  a->lockus -= b->lockus;
+  for(i = 0; i < NBLKDEV; i++){
+    x = &a->dev[i];
+    y = &b->dev[i];
+    x->reads -= y->reads;
+    x->writes -= y->writes;
+    x->rblocks -= y->rblocks;
+    x->wblocks -= y->wblocks;
+    x->busyus -= y->busyus;
+    x->waitus -= y->waitus;
+  }
+}
+
+// a as a percentage of n, without overflowing.
+static uint
+percent(uint a, uint n)
+{
+  if(n == 0)
+    return 0;
+  return n < 0x1000000 ? a * 100 / n : a / (n / 100);
+}
+
+// Blocks to KB, without overflowing.
+static uint
+kb(uint blocks, uint bsize)
+{
+  return bsize >= 1024 ? blocks * (bsize / 1024) : blocks / (1024 / bsize);
+}
+
+static void
+show(struct iostat *st)
+{
+  struct iodev *d;
+  uint n;
+  int i, k;
+
+  n = st->hits + st->misses;
+  printf(1, "cache: %d buffers of %d bytes\n", st->nbuf, st->bsize);
+  printf(1, "  %d lookups, %d hits (%d%%), %d misses, %d read ahead\n",
+         n, st->hits, percent(st->hits, n),
+         st->misses, st->readahead);
+  printf(1, "  %d ms waiting for busy buffers\n", st->lockus / 1000);
+
+  printf(1, "DEV NAME      READS    RKB WRITES    WKB BLK/XFER BUSY(ms) WAIT(ms)\n");
+  for(i = 0; i < NBLKDEV; i++){
+    d = &st->dev[i];
+    if(d->size == 0)
+      continue;
+    padint(i, 3);
+    printf(1, "%s", d->name);
+    for(k = strlen(d->name); k < 8; k++)
+      printf(1, " ");
+    padint(d->reads, 6);
+    padint(kb(d->rblocks, st->bsize), 6);
+    padint(d->writes, 6);
+    padint(kb(d->wblocks, st->bsize), 6);
+    n = d->reads + d->writes;
+    padint(n ? (d->rblocks + d->wblocks) / n : 0, 8);
+    padint(d->busyus / 1000, 8);
+    padint(d->waitus / 1000, 8);
+    printf(1, "\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(iostat(&before) < 0){
+    printf(2, "iostat: iostat failed\n");
+    exit();
+  }
+  if(argc < 2){
+    show(&before);
+    exit();
+  }
+
+  if((pid = fork()) < 0){
+    printf(2, "iostat: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv+1);
+    printf(2, "iostat: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  if(iostat(&after) < 0){
+    printf(2, "iostat: iostat failed\n");
+    exit();
+  }
+  subtract(&after, &before);
+  show(&after);
+  exit();
+}
@@ -0,0 +1,99 @@
+// irqstat: show how often each device interrupt ran and how
+// long its handler took.
+//   irqstat       totals since boot
+//   irqstat -t    redisplay every second with per-interval counts
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "irqstat.h"
+
+struct irqstat cur[NIRQ], prev[NIRQ];
+
+static char*
+irqname(int irq)
+{
+  switch(irq){
+  case 1:  return "timer1";
+  case 3:  return "timer3";
+  case 9:  return "usb";
+  case 29: return "aux";
+  case 57: return "uart";
+  case 62: return "emmc";
+  case IRQ_ARM+0: return "armtimer";
+  case IRQ_ARM+1: return "mailbox";
+  }
+  if(irq >= 16 && irq <= 28)
+    return "dma";
+  return "";
+}
+
+// Print x right-aligned in a field of width w.
+static void
+padint(uint x, int w)
+{
+  char buf[12];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = 0;
+  do{
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  }while(x && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf(1, "%s ", buf + i);
+}
+
+static void
+show(int n, int delta)
+{
+  uint count, time;
+  int i;
+
+  printf(1, "IRQ    COUNT  AVG(us)  MAX(us)  MAXLAT(us) NAME\n");
+  for(i = 0; i < n; i++){
+    if(!cur[i].registered && cur[i].count == 0)
+      continue;
+    count = cur[i].count;
+    time = cur[i].time;
+    if(delta){
+      count -= prev[i].count;
+      time -= prev[i].time;
+    }
+    padint(i, 3);
+    padint(count, 8);
+    padint(count ? time / count : 0, 8);
+    padint(cur[i].maxtime, 8);
+    padint(cur[i].maxlatency, 10);
+    printf(1, "%s\n", irqname(i));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n, top;
+
+  top = argc > 1 && strcmp(argv[1], "-t") == 0;
+  if(argc > 1 && !top){
+    printf(2, "usage: irqstat [-t]\n");
+    exit();
+  }
+  if((n = irqstat(cur, NIRQ)) < 0){
+    printf(2, "irqstat: irqstat failed\n");
+    exit();
+  }
+  if(!top){
+    show(n, 0);
+    exit();
+  }
+  for(;;){
+    memmove(prev, cur, sizeof(cur));
+    sleep(100);
+    if((n = irqstat(cur, NIRQ)) < 0)
+      exit();
+    printf(1, "\n");
+    show(n, 1);
+  }
+}
@@ -0,0 +1,89 @@
+// irqtrace: show interrupt latency and how long the kernel runs
+// with interrupts off.  Needs a kernel built with IRQTRACE=1.
+//   irqtrace              totals since boot
+//   irqtrace cmd [args]   only while cmd runs
+// Look up the pcs of the longest interrupts-off stretch in
+// kernel.asm to see who held the cpu.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "irqtrace.h"
+
+struct irqtrace t[NTRACE];
+
+static char *names[NTRACE] = {
+  [TR_ENTRY] "irq entry",
+  [TR_IRQ]   "irq handling",
+  [TR_CLI]   "irqs off",
+};
+
+// Print x right-aligned in a field of width w.
+static void
+padint(uint x, int w)
+{
+  char buf[12];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = 0;
+  do{
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  }while(x && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf(1, "%s ", buf + i);
+}
+
+static void
+show(void)
+{
+  int k, i;
+
+  printf(1, "                  COUNT  AVG(us)  MAX(us)\n");
+  for(k = 0; k < NTRACE; k++){
+    printf(1, "%s", names[k]);
+    for(i = strlen(names[k]); i < 14; i++)
+      printf(1, " ");
+    padint(t[k].count, 9);
+    padint(t[k].count ? t[k].total / t[k].count : 0, 8);
+    padint(t[k].max, 8);
+    printf(1, "\n");
+  }
+  for(k = 0; k < NTRACE; k++){
+    printf(1, "\n%s:", names[k]);
+    for(i = 0; i < NTRACEHIST; i++)
+      if(t[k].hist[i])
+        printf(1, " <%dus:%d", 1 << i, t[k].hist[i]);
+  }
+  printf(1, "\n\nlongest irqs off from:");
+  for(i = 0; i < NTRACEPC && t[TR_CLI].maxpc[i]; i++)
+    printf(1, " %x", t[TR_CLI].maxpc[i]);
+  printf(1, "\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid;
+
+  if(irqtrace(t, argc > 1) < 0){
+    printf(2, "irqtrace: kernel not built with IRQTRACE=1\n");
+    exit();
+  }
+  if(argc > 1){
+    if((pid = fork()) < 0){
+      printf(2, "irqtrace: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      printf(2, "irqtrace: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+    irqtrace(t, 0);
+  }
+  show();
+  exit();
+}
@@ -0,0 +1,129 @@
+// lockstat: show the most contended kernel spinlocks.  Needs a
+// kernel built with LOCKSTAT=1.
+//   lockstat              totals since boot
+//   lockstat cmd [args]   only what happened while cmd ran
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "lockstat.h"
+
+#define NSHOW 8   // locks shown in detail
+
+struct lockstat before[NLOCKCLASS], after[NLOCKCLASS];
+
+// Print x right-aligned in a field of width w.
+static void
+padint(uint x, int w)
+{
+  char buf[12];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = 0;
+  do{
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  }while(x && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf(1, "%s ", buf + i);
+}
+
+// Subtract the before snapshot from the after one.
+static void
+subtract(struct lockstat *a, struct lockstat *b)
+{
+  int i;
+
+  a->nacquire -= b->nacquire;
+  a->ncontended -= b->ncontended;
+  a->waittime -= b->waittime;
+  a->holdtime -= b->holdtime;
+  for(i = 0; i < NLOCKHIST; i++){
+    a->waithist[i] -= b->waithist[i];
+    a->holdhist[i] -= b->holdhist[i];
+  }
+  for(i = 0; i < NLOCKSITE; i++)
+    if(a->sitepc[i] == b->sitepc[i])
+      a->sitecount[i] -= b->sitecount[i];
+}
+
+static void
+showhist(char *what, uint *hist)
+{
+  int i;
+
+  printf(1, "    %s:", what);
+  for(i = 0; i < NLOCKHIST; i++)
+    if(hist[i])
+      printf(1, " <%dus:%d", 1 << i, hist[i]);
+  printf(1, "\n");
+}
+
+static void
+show(struct lockstat *ls, int n)
+{
+  struct lockstat t;
+  int i, j, k;
+
+  // Most contended first.
+  for(i = 1; i < n; i++){
+    t = ls[i];
+    for(j = i; j > 0 && ls[j-1].ncontended < t.ncontended; j--)
+      ls[j] = ls[j-1];
+    ls[j] = t;
+  }
+
+  printf(1, "NAME            ACQUIRE  CONTEND  WAIT(us)  HOLD(us)\n");
+  for(i = 0; i < n; i++){
+    printf(1, "%s", ls[i].name);
+    for(k = strlen(ls[i].name); k < 15; k++)
+      printf(1, " ");
+    padint(ls[i].nacquire, 8);
+    padint(ls[i].ncontended, 8);
+    padint(ls[i].waittime, 9);
+    padint(ls[i].holdtime, 9);
+    printf(1, "\n");
+  }
+
+  for(i = 0; i < n && i < NSHOW && ls[i].ncontended > 0; i++){
+    printf(1, "\n%s:\n", ls[i].name);
+    showhist("wait", ls[i].waithist);
+    showhist("hold", ls[i].holdhist);
+    for(k = 0; k < NLOCKSITE; k++)
+      if(ls[i].sitepc[k] && ls[i].sitecount[k])
+        printf(1, "    contended from %x: %d\n", ls[i].sitepc[k], ls[i].sitecount[k]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, pid;
+
+  if((n = lockstat(before, NLOCKCLASS)) < 0){
+    printf(2, "lockstat: kernel not built with LOCKSTAT=1\n");
+    exit();
+  }
+  if(argc < 2){
+    show(before, n);
+    exit();
+  }
+
+  if((pid = fork()) < 0){
+    printf(2, "lockstat: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv+1);
+    printf(2, "lockstat: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  n = lockstat(after, NLOCKCLASS);
+  // Classes are only ever appended, so index i matches.
+  for(i = 0; i < n; i++)
+    subtract(&after[i], &before[i]);
+  show(after, n);
+  exit();
+}
@@ -0,0 +1,19 @@
+// Per-lock-class contention statistics returned by the
+// lockstat() system call (kernels built with LOCKSTAT=1).
+// Both the kernel and user programs use this header file.
+
+#define NLOCKCLASS 24 // lock classes (names) the kernel tracks
+#define NLOCKHIST 16  // log2 histogram buckets of microseconds
+#define NLOCKSITE 4   // call sites remembered per lock class
+
+struct lockstat {
+  char name[16];          // name given to initlock
+  uint nacquire;          // acquires
+  uint ncontended;        // acquires that had to spin
+  uint waittime;          // total us spent spinning
+  uint holdtime;          // total us held
+  uint waithist[NLOCKHIST]; // bucket i: spun for < 2^i us
+  uint holdhist[NLOCKHIST]; // bucket i: held for < 2^i us
+  uint sitepc[NLOCKSITE];   // callers of contended acquires
+  uint sitecount[NLOCKSITE];
+};
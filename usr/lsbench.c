@@ -0,0 +1,107 @@
+// lsbench: time directory listings (what ls / does, without the
+// output) first on an idle system and then while another process
+// reads a large file over and over, to show whether the buffer
+// cache keeps the metadata blocks through the scan.
+//   lsbench [kbytes]     size of the streamed file, default 64
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "fs.h"
+#include "iostat.h"
+
+#define NLIST 50
+
+char *file = "lsbench.tmp";
+char buf[512];
+
+// List / and stat every entry.
+static void
+list(void)
+{
+  struct dirent de;
+  struct stat st;
+  char path[DIRSIZ+2];
+  int fd;
+
+  if((fd = open("/", O_RDONLY)) < 0){
+    printf(2, "lsbench: cannot open /\n");
+    exit();
+  }
+  path[0] = '/';
+  while(read(fd, &de, sizeof(de)) == sizeof(de)){
+    if(de.inum == 0)
+      continue;
+    memmove(path+1, de.name, DIRSIZ);
+    path[DIRSIZ+1] = 0;
+    stat(path, &st);
+  }
+  close(fd);
+}
+
+// Time NLIST listings and print them with the cache hit rate.
+static void
+run(char *what)
+{
+  struct iostat s0, s1;
+  uint t, total, max, hits, lookups;
+  int i;
+
+  iostat(&s0);
+  total = max = 0;
+  for(i = 0; i < NLIST; i++){
+    t = vclock();
+    list();
+    t = vclock() - t;
+    total += t;
+    if(t > max)
+      max = t;
+  }
+  iostat(&s1);
+  hits = s1.hits - s0.hits;
+  lookups = hits + s1.misses - s0.misses;
+  printf(1, "%s: avg %d us, max %d us, cache hits %d/%d\n",
+         what, total / NLIST, max, hits, lookups);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct iostat st;
+  int fd, i, n, pid;
+
+  n = argc > 1 ? atoi(argv[1]) * 2 : 128;
+  if(n > MAXFILE)
+    n = MAXFILE;
+  if((fd = open(file, O_CREATE|O_RDWR)) < 0){
+    printf(2, "lsbench: cannot create %s\n", file);
+    exit();
+  }
+  memset(buf, 'x', sizeof(buf));
+  for(i = 0; i < n; i++){
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf(2, "lsbench: write failed, disk full?\n");
+      break;
+    }
+  }
+  close(fd);
+  iostat(&st);
+  printf(1, "%d buffers; streaming %d blocks\n", st.nbuf, i);
+
+  run("idle");
+  if((pid = fork()) == 0){
+    for(;;){
+      if((fd = open(file, O_RDONLY)) < 0)
+        exit();
+      while(read(fd, buf, sizeof(buf)) > 0)
+        ;
+      close(fd);
+    }
+  }
+  sleep(10);
+  run("with a scan");
+  kill(pid);
+  wait();
+  unlink(file);
+  exit();
+}
@@ -0,0 +1,83 @@
+// mpbench: run the same grep-like workload split across 1, 2
+// and 4 processes and report the elapsed ticks, to show how the
+// kernel scales across cores.
+//   mpbench [pattern [file]]    defaults: "the" in README
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+#define NSCAN 256   // total passes over the file, split among workers
+
+char *text;
+int textlen;
+
+// Count the occurrences of pat in text.
+int
+scan(char *pat)
+{
+  int i, j, n;
+
+  n = 0;
+  for(i = 0; i < textlen; i++){
+    for(j = 0; pat[j] && i + j < textlen && text[i+j] == pat[j]; j++)
+      ;
+    if(pat[j] == 0)
+      n++;
+  }
+  return n;
+}
+
+// Run NSCAN scans in nproc processes; return the elapsed ticks.
+int
+run(int nproc, char *pat)
+{
+  int i, k, start;
+
+  start = uptime();
+  for(i = 0; i < nproc; i++){
+    if(fork() == 0){
+      for(k = 0; k < NSCAN / nproc; k++)
+        scan(pat);
+      exit();
+    }
+  }
+  for(i = 0; i < nproc; i++)
+    wait();
+  return uptime() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *pat, *file;
+  struct stat st;
+  int fd, nproc, t, t1;
+
+  pat = argc > 1 ? argv[1] : "the";
+  file = argc > 2 ? argv[2] : "README";
+  if((fd = open(file, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    printf(2, "mpbench: cannot open %s\n", file);
+    exit();
+  }
+  textlen = st.size;
+  if((text = malloc(textlen)) == 0 || read(fd, text, textlen) != textlen){
+    printf(2, "mpbench: cannot read %s\n", file);
+    exit();
+  }
+  close(fd);
+
+  printf(1, "%d matches of \"%s\" in %s, %d scans per run\n",
+         scan(pat), pat, file, NSCAN);
+  t1 = 0;
+  for(nproc = 1; nproc <= 4; nproc *= 2){
+    t = run(nproc, pat);
+    if(nproc == 1)
+      t1 = t;
+    if(t == 0)
+      t = 1;
+    printf(1, "%d procs: %d ticks, speedup %d.%d%d\n", nproc, t,
+           t1 / t, (t1 * 10 / t) % 10, (t1 * 100 / t) % 10);
+  }
+  exit();
+}
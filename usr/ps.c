@@ -0,0 +1,117 @@
+// ps: list processes with their CPU and scheduling statistics.
+//   ps       one snapshot, totals since each process started
+//   ps -t    top-like mode: redisplay every second, showing the
+//            ticks each process used during the last interval
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+static char *states[] = {
+  "unused", "embryo", "sleep", "runble", "run", "zombie"
+};
+
+struct pstat cur[NPROC], prev[NPROC];
+int ncur, nprev;
+
+// Print s padded with spaces to width w.
+static void
+pad(char *s, int w)
+{
+  int n;
+
+  n = strlen(s);
+  printf(1, "%s", s);
+  while(n++ < w)
+    printf(1, " ");
+}
+
+// Print x right-aligned in a field of width w.
+static void
+padint(uint x, int w)
+{
+  char buf[12];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = 0;
+  do{
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  }while(x && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf(1, "%s ", buf + i);
+}
+
+static struct pstat*
+findprev(int pid)
+{
+  int i;
+
+  for(i = 0; i < nprev; i++)
+    if(prev[i].pid == pid)
+      return &prev[i];
+  return 0;
+}
+
+static void
+show(int delta)
+{
+  struct pstat *p, *o;
+  uint ut, st;
+  int i;
+
+  printf(1, "  PID  PPID STATE    USER   SYS  VCSW IVCSW SYSCALL FAULT NAME\n");
+  for(i = 0; i < ncur; i++){
+    p = &cur[i];
+    ut = p->utime;
+    st = p->stime;
+    if(delta && (o = findprev(p->pid)) != 0){
+      ut -= o->utime;
+      st -= o->stime;
+    }
+    padint(p->pid, 5);
+    padint(p->ppid, 5);
+    pad(p->state >= 0 && p->state < sizeof(states)/sizeof(states[0]) ? states[p->state] : "???", 7);
+    padint(ut, 6);
+    padint(st, 5);
+    padint(p->nvcsw, 5);
+    padint(p->nivcsw, 5);
+    padint(p->nsyscall, 7);
+    padint(p->npgfault, 5);
+    printf(1, "%s\n", p->name);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int top;
+
+  top = argc > 1 && strcmp(argv[1], "-t") == 0;
+  if(argc > 1 && !top){
+    printf(2, "usage: ps [-t]\n");
+    exit();
+  }
+
+  if((ncur = getprocs(cur, NPROC)) < 0){
+    printf(2, "ps: getprocs failed\n");
+    exit();
+  }
+  if(!top){
+    show(0);
+    exit();
+  }
+
+  for(;;){
+    memmove(prev, cur, ncur * sizeof(cur[0]));
+    nprev = ncur;
+    sleep(100);
+    if((ncur = getprocs(cur, NPROC)) < 0)
+      exit();
+    printf(1, "\n");
+    show(1);
+  }
+}
@@ -0,0 +1,16 @@
+// Per-process statistics returned by the getprocs() system call.
+// Both the kernel and user programs use this header file.
+
+struct pstat {
+  int pid;
+  int ppid;
+  int state;          // enum procstate
+  uint sz;            // Size of process memory (bytes)
+  uint utime;         // Ticks spent in user mode
+  uint stime;         // Ticks spent in kernel mode
+  uint nvcsw;         // Voluntary context switches
+  uint nivcsw;        // Involuntary context switches
+  uint nsyscall;      // System calls made
+  uint npgfault;      // Page faults (prefetch/data aborts)
+  char name[16];
+};
@@ -0,0 +1,130 @@
+// ringbench: compare small reads and writes made one system
+// call at a time with the same operations batched through
+// ringenter().
+//   ringbench [nops]     default 4096 operations per test
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "uring.h"
+
+#define CHUNK 16
+
+struct uring ring;
+char buf[CHUNK];
+char *file = "ringbench.tmp";
+
+// Queue op and, when the ring is full or flush is set, submit
+// everything queued and reap the completions.
+static void
+queue(int op, int fd, char *addr, int n, int flush)
+{
+  struct sqe *e;
+
+  e = &ring.sq[ring.sqtail % NRING];
+  e->op = op;
+  e->fd = fd;
+  e->addr = (uint)addr;
+  e->n = n;
+  e->tag = ring.sqtail;
+  ring.sqtail++;
+  if(flush || ring.sqtail - ring.sqhead == NRING){
+    while(ring.sqhead != ring.sqtail){
+      if(ringenter(&ring) < 0){
+        printf(2, "ringbench: ringenter failed\n");
+        exit();
+      }
+      while(ring.cqhead != ring.cqtail){
+        if(ring.cq[ring.cqhead % NRING].res < 0){
+          printf(2, "ringbench: operation %d failed\n",
+                 ring.cq[ring.cqhead % NRING].tag);
+          exit();
+        }
+        ring.cqhead++;
+      }
+    }
+  }
+}
+
+static int
+openfile(int omode)
+{
+  int fd;
+
+  if((fd = open(file, omode)) < 0){
+    printf(2, "ringbench: cannot open %s\n", file);
+    exit();
+  }
+  return fd;
+}
+
+static void
+report(char *what, int t0, int t1)
+{
+  if(t1 == 0)
+    t1 = 1;
+  printf(1, "%s: syscalls %d ticks, ring %d ticks, speedup %d.%d\n",
+         what, t0, t1, t0 / t1, (t0 * 10 / t1) % 10);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, fd, start, t0, t1;
+
+  n = argc > 1 ? atoi(argv[1]) : 4096;
+  memset(buf, 'x', sizeof(buf));
+  printf(1, "%d operations of %d bytes, up to %d per ringenter\n",
+         n, CHUNK, NRING);
+
+  // Null operations: the bare cost of entering the kernel.
+  start = uptime();
+  for(i = 0; i < n; i++)
+    getpid();
+  t0 = uptime() - start;
+  start = uptime();
+  for(i = 0; i < n; i++)
+    queue(RING_NOP, 0, 0, 0, i == n-1);
+  t1 = uptime() - start;
+  report("nop", t0, t1);
+
+  start = uptime();
+  fd = openfile(O_CREATE|O_RDWR);
+  for(i = 0; i < n; i++)
+    if(write(fd, buf, CHUNK) != CHUNK){
+      printf(2, "ringbench: write failed\n");
+      exit();
+    }
+  close(fd);
+  t0 = uptime() - start;
+  unlink(file);
+  start = uptime();
+  queue(RING_OPEN, 0, file, O_CREATE|O_RDWR, 1);
+  fd = ring.cq[(ring.cqhead-1) % NRING].res;
+  for(i = 0; i < n; i++)
+    queue(RING_WRITE, fd, buf, CHUNK, 0);
+  queue(RING_CLOSE, fd, 0, 0, 1);
+  t1 = uptime() - start;
+  report("write", t0, t1);
+
+  start = uptime();
+  fd = openfile(O_RDONLY);
+  for(i = 0; i < n; i++)
+    if(read(fd, buf, CHUNK) != CHUNK){
+      printf(2, "ringbench: read failed\n");
+      exit();
+    }
+  close(fd);
+  t0 = uptime() - start;
+  start = uptime();
+  queue(RING_OPEN, 0, file, O_RDONLY, 1);
+  fd = ring.cq[(ring.cqhead-1) % NRING].res;
+  for(i = 0; i < n; i++)
+    queue(RING_READ, fd, buf, CHUNK, 0);
+  queue(RING_CLOSE, fd, 0, 0, 1);
+  t1 = uptime() - start;
+  report("read", t0, t1);
+
+  unlink(file);
+  exit();
+}
@@ -0,0 +1,223 @@
+// strace: trace system calls.
+//   strace cmd [args]     trace cmd and the processes it forks
+//   strace -p pid         trace a running process, such as wm
+//   strace -c cmd [args]  count the calls made while cmd runs
+//                         (by every process) instead
+//   strace -c             per-call counts and latency since boot
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+#include "syscall.h"
+#include "strace.h"
+
+#define NREAD 32
+
+static struct {
+  char *name;
+  int nargs;
+} calls[NSYSCALL] = {
+  [SYS_fork]      {"fork", 0},
+  [SYS_exit]      {"exit", 0},
+  [SYS_wait]      {"wait", 0},
+  [SYS_pipe]      {"pipe", 1},
+  [SYS_read]      {"read", 3},
+  [SYS_kill]      {"kill", 1},
+  [SYS_exec]      {"exec", 2},
+  [SYS_fstat]     {"fstat", 2},
+  [SYS_chdir]     {"chdir", 1},
+  [SYS_dup]       {"dup", 1},
+  [SYS_getpid]    {"getpid", 0},
+  [SYS_sbrk]      {"sbrk", 1},
+  [SYS_sleep]     {"sleep", 1},
+  [SYS_uptime]    {"uptime", 0},
+  [SYS_open]      {"open", 2},
+  [SYS_write]     {"write", 3},
+  [SYS_mknod]     {"mknod", 3},
+  [SYS_unlink]    {"unlink", 1},
+  [SYS_link]      {"link", 2},
+  [SYS_mkdir]     {"mkdir", 1},
+  [SYS_close]     {"close", 1},
+  [SYS_getprocs]  {"getprocs", 2},
+  [SYS_clone]     {"clone", 3},
+  [SYS_join]      {"join", 0},
+  [SYS_futexwait] {"futexwait", 2},
+  [SYS_futexwake] {"futexwake", 2},
+  [SYS_lockstat]  {"lockstat", 2},
+  [SYS_irqstat]   {"irqstat", 2},
+  [SYS_irqtrace]  {"irqtrace", 2},
+  [SYS_strace]    {"strace", 3},
+  [SYS_traceread] {"traceread", 2},
+  [SYS_sysstat]   {"sysstat", 2},
+  [SYS_ringenter] {"ringenter", 1},
+  [SYS_iostat]    {"iostat", 1},
+  [SYS_sync]      {"sync", 0},
+};
+
+struct traceent ents[NREAD];
+struct sysstat before[NSYSCALL], after[NSYSCALL];
+struct pstat ps[NPROC];
+uint nextseq;
+
+// Print x right-aligned in a field of width w.
+static void
+padint(uint x, int w)
+{
+  char buf[12];
+  int i;
+
+  i = sizeof(buf) - 1;
+  buf[i] = 0;
+  do{
+    buf[--i] = '0' + x % 10;
+    x /= 10;
+  }while(x && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf(1, "%s ", buf + i);
+}
+
+static void
+printent(struct traceent *e)
+{
+  int i, nargs;
+
+  if(e->seq != nextseq)
+    printf(1, "... %d calls lost\n", e->seq - nextseq);
+  nextseq = e->seq + 1;
+  nargs = 4;
+  if(e->num < NSYSCALL && calls[e->num].name){
+    printf(1, "%d %s(", e->pid, calls[e->num].name);
+    nargs = calls[e->num].nargs;
+  } else
+    printf(1, "%d syscall%d(", e->pid, e->num);
+  for(i = 0; i < nargs; i++)
+    printf(1, i ? ", %x" : "%x", e->args[i]);
+  if(e->num == SYS_exit)
+    printf(1, ")\n");
+  else
+    printf(1, ") = %d  <%dus>\n", e->ret, e->usec);
+}
+
+// Is pid still running (not a zombie)?
+static int
+alive(int pid)
+{
+  int i, n;
+
+  n = getprocs(ps, NPROC);
+  for(i = 0; i < n; i++)
+    if(ps[i].pid == pid)
+      return ps[i].state != 5;  // ZOMBIE
+  return 0;
+}
+
+// Print what the ring holds until pid is gone, or forever if
+// stop is 0.
+static void
+follow(int pid, int stop)
+{
+  int i, n;
+
+  for(;;){
+    n = traceread(ents, NREAD);
+    for(i = 0; i < n; i++)
+      printent(&ents[i]);
+    if(n == 0){
+      if(stop && !alive(pid)){
+        while((n = traceread(ents, NREAD)) > 0)
+          for(i = 0; i < n; i++)
+            printent(&ents[i]);
+        return;
+      }
+      sleep(1);
+    }
+  }
+}
+
+static void
+summary(struct sysstat *st)
+{
+  int num, i;
+
+  printf(1, "CALL           COUNT  AVG(us)  MAX(us)  HISTOGRAM(us)\n");
+  for(num = 0; num < NSYSCALL; num++){
+    if(st[num].count == 0)
+      continue;
+    if(calls[num].name){
+      printf(1, "%s", calls[num].name);
+      i = strlen(calls[num].name);
+    } else {
+      printf(1, "syscall%d", num);
+      i = 9;
+    }
+    for(; i < 12; i++)
+      printf(1, " ");
+    padint(st[num].count, 8);
+    padint(st[num].time / st[num].count, 8);
+    padint(st[num].max, 8);
+    for(i = 0; i < NSYSHIST; i++)
+      if(st[num].hist[i])
+        printf(1, " <%d:%d", 1 << i, st[num].hist[i]);
+    printf(1, "\n");
+  }
+}
+
+// Run argv; if trace, with every call traced.
+static int
+run(char **argv, int trace)
+{
+  int pid;
+
+  if((pid = fork()) < 0){
+    printf(2, "strace: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    if(trace)
+      strace(getpid(), ~0, ~0);
+    exec(argv[0], argv);
+    printf(2, "strace: exec %s failed\n", argv[0]);
+    exit();
+  }
+  return pid;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid, num;
+
+  // Skip what earlier traces left in the ring.
+  while(traceread(ents, NREAD) == NREAD)
+    ;
+
+  if(argc == 2 && strcmp(argv[1], "-c") == 0){
+    sysstat(before, NSYSCALL);
+    summary(before);
+  } else if(argc > 2 && strcmp(argv[1], "-c") == 0){
+    sysstat(before, NSYSCALL);
+    run(argv+2, 0);
+    wait();
+    sysstat(after, NSYSCALL);
+    for(num = 0; num < NSYSCALL; num++){
+      after[num].count -= before[num].count;
+      after[num].time -= before[num].time;
+    }
+    summary(after);
+  } else if(argc == 3 && strcmp(argv[1], "-p") == 0){
+    pid = atoi(argv[2]);
+    if(strace(pid, ~0, ~0) < 0){
+      printf(2, "strace: no process %d\n", pid);
+      exit();
+    }
+    follow(pid, 1);
+  } else if(argc > 1 && argv[1][0] != '-'){
+    pid = run(argv+1, 1);
+    follow(pid, 1);
+    wait();
+  } else
+    printf(2, "usage: strace [-c] [cmd args...] | -p pid\n");
+  exit();
+}
@@ -0,0 +1,13 @@
+// sync: commit the file system log and write a RAM disk back
+// to the image it was loaded from.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int
+main(void)
+{
+  if(sync() < 0)
+    printf(2, "sync: RAM disk not written back\n");
+  exit();
+}
@@ -0,0 +1,40 @@
+// Submission and completion queues shared between a user
+// program and the kernel, for the ringenter() system call.
+// Both the kernel and user programs use this header file.
+//
+// The program fills sq[sqtail % NRING] and advances sqtail;
+// ringenter() runs the queued operations in order, advancing
+// sqhead, and posts one completion per operation at
+// cq[cqtail % NRING].  The program consumes completions by
+// advancing cqhead.  The indices only ever increase.
+
+#define NRING       64    // entries in each queue; a power of two
+
+// Operations.
+#define RING_NOP    0
+#define RING_READ   1     // read(fd, addr, n)
+#define RING_WRITE  2     // write(fd, addr, n)
+#define RING_OPEN   3     // open((char*)addr, n)
+#define RING_CLOSE  4     // close(fd)
+
+struct sqe {
+  int op;
+  int fd;
+  uint addr;
+  int n;
+  uint tag;           // copied to the completion
+};
+
+struct cqe {
+  uint tag;
+  int res;            // what the system call would return
+};
+
+struct uring {
+  uint sqhead;        // advanced by the kernel
+  uint sqtail;        // advanced by the program
+  uint cqhead;        // advanced by the program
+  uint cqtail;        // advanced by the kernel
+  struct sqe sq[NRING];
+  struct cqe cq[NRING];
+};
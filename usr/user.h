@@ -1,4 +1,12 @@
 struct stat;
+struct pstat;
+struct lockstat;
+struct irqstat;
+struct irqtrace;
+struct traceent;
+struct sysstat;
+struct uring;
+struct iostat;
 
 // system calls
 int fork(void);
@@ -22,6 +30,20 @@ int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
+int getprocs(struct pstat*, int);
+int clone(void(*)(void*), void*, void*);
+int join(void);
+int futexwait(volatile uint*, uint);
+int futexwake(volatile uint*, int);
+int lockstat(struct lockstat*, int);
+int irqstat(struct irqstat*, int);
+int irqtrace(struct irqtrace*, int);
+int strace(int, uint, uint);
+int traceread(struct traceent*, int);
+int sysstat(struct sysstat*, int);
+int ringenter(struct uring*);
+int iostat(struct iostat*);
+int sync(void);
 
 // ulib.c
 int stat(char*, struct stat*);
@@ -37,6 +59,28 @@ void* malloc(uint);
 void free(void*);
 int atoi(const char*);
 
+// vdso.c
+uint vuptime(void);
+int vgetpid(void);
+uint vclock(void);
+
+// uthread.c
+struct ulock {
+  volatile uint locked;  // 0 free, 1 held, 2 held with waiters
+};
+struct ucond {
+  volatile uint seq;
+};
+int thread_create(void(*)(void*), void*);
+int thread_join(void);
+void lock_init(struct ulock*);
+void lock_acquire(struct ulock*);
+void lock_release(struct ulock*);
+void cond_init(struct ucond*);
+void cond_wait(struct ucond*, struct ulock*);
+void cond_signal(struct ucond*);
+void cond_broadcast(struct ucond*);
+
 typedef struct {
   uint x;
   uint y;
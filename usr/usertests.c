@@ -1591,6 +1591,112 @@ fsfull()
   printf(1, "fsfull test finished\n");
 }
 
+// threads share memory, are reaped by thread_join and not by wait,
+// block on futex-based locks and condition variables, and an
+// exiting leader takes its threads with it.
+struct ulock threadlock;
+int threadcount;
+
+void
+threadinc(void *arg)
+{
+  int i;
+
+  for(i = 0; i < 1000; i++){
+    lock_acquire(&threadlock);
+    threadcount += (int)arg;
+    lock_release(&threadlock);
+  }
+}
+
+struct ucond threadcond;
+int threadready;
+
+void
+threadwaiter(void *arg)
+{
+  lock_acquire(&threadlock);
+  while(!threadready)
+    cond_wait(&threadcond, &threadlock);
+  threadcount++;
+  lock_release(&threadlock);
+}
+
+void
+threadspin(void *arg)
+{
+  for(;;)
+    ;
+}
+
+void
+threadtest(void)
+{
+  int i, pid;
+
+  printf(1, "thread test\n");
+
+  lock_init(&threadlock);
+  threadcount = 0;
+  for(i = 0; i < 4; i++){
+    if(thread_create(threadinc, (void*)1) < 0){
+      printf(1, "thread_create failed\n");
+      exit();
+    }
+  }
+  if(wait() != -1){
+    printf(1, "wait returned a thread\n");
+    exit();
+  }
+  for(i = 0; i < 4; i++){
+    if(thread_join() < 0){
+      printf(1, "thread_join failed\n");
+      exit();
+    }
+  }
+  if(thread_join() != -1){
+    printf(1, "thread_join got too many\n");
+    exit();
+  }
+  if(threadcount != 4000){
+    printf(1, "threadcount %d, expected 4000\n", threadcount);
+    exit();
+  }
+
+  if(futexwait(&threadlock.locked, 1) != -1){
+    printf(1, "futexwait on a changed value slept\n");
+    exit();
+  }
+  threadready = 0;
+  cond_init(&threadcond);
+  thread_create(threadwaiter, 0);
+  lock_acquire(&threadlock);
+  threadready = 1;
+  cond_signal(&threadcond);
+  lock_release(&threadlock);
+  if(thread_join() < 0 || threadcount != 4001){
+    printf(1, "cond_signal lost\n");
+    exit();
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf(1, "fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    thread_create(threadspin, 0);
+    thread_create(threadspin, 0);
+    exit();
+  }
+  if(wait() != pid){
+    printf(1, "wait for thread leader failed\n");
+    exit();
+  }
+
+  printf(1, "thread test OK\n");
+}
+
 unsigned long randstate = 1;
 unsigned int
 rand()
@@ -1641,6 +1747,7 @@ main(int argc, char *argv[])
   dirfile();
   iref();
   forktest();
+  threadtest();
   bigdir(); // slow
 
   exectest();
@@ -0,0 +1,209 @@
+// User-level threads on top of clone() and join().
+// Each thread gets a malloc'd stack; thread_join() frees it.
+// Threads share memory but not descriptors: each starts with a
+// copy of its creator's, as after fork().
+// Locks and condition variables only enter the kernel, via
+// futexwait/futexwake, when there is contention.
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define TSTACKSIZE 4096
+#define NTHREAD    16
+
+struct tinfo {
+  void (*fn)(void*);
+  void *arg;
+};
+
+static struct {
+  struct ulock lock;   // protects stacks[] and malloc/free
+  int tid[NTHREAD];
+  char *stack[NTHREAD];
+} threads;
+
+// Atomically replace *addr with new and return the old value.
+static uint
+xchg(volatile uint *addr, uint new)
+{
+  uint old, fail;
+
+  do{
+    asm volatile("ldrex %0, [%2]\n\t"
+                 "strex %1, %3, [%2]"
+                 : "=&r"(old), "=&r"(fail)
+                 : "r"(addr), "r"(new)
+                 : "memory");
+  }while(fail);
+  return old;
+}
+
+// Atomically replace *addr with new if it holds expected.
+// Return the old value.
+static uint
+cas(volatile uint *addr, uint expected, uint new)
+{
+  uint old, fail;
+
+  do{
+    fail = 0;
+    asm volatile("ldrex %0, [%2]\n\t"
+                 "teq %0, %3\n\t"
+                 "strexeq %1, %4, [%2]"
+                 : "=&r"(old), "+&r"(fail)
+                 : "r"(addr), "r"(expected), "r"(new)
+                 : "cc", "memory");
+  }while(fail);
+  // On a mismatch the ldrex is left without its strex; clear
+  // the exclusive monitor it armed.
+  if(old != expected)
+    asm volatile("clrex" ::: "memory");
+  return old;
+}
+
+// Atomically add n to *addr.
+static void
+atomic_add(volatile uint *addr, uint n)
+{
+  uint v, fail;
+
+  do{
+    asm volatile("ldrex %0, [%2]\n\t"
+                 "add %0, %0, %3\n\t"
+                 "strex %1, %0, [%2]"
+                 : "=&r"(v), "=&r"(fail)
+                 : "r"(addr), "r"(n)
+                 : "memory");
+  }while(fail);
+}
+
+void
+lock_init(struct ulock *l)
+{
+  l->locked = 0;
+}
+
+// Take the lock, entering the kernel only if it is held.
+// A waiter marks the lock 2 so that the holder knows to
+// call futexwake on release.
+void
+lock_acquire(struct ulock *l)
+{
+  uint c;
+
+  if((c = cas(&l->locked, 0, 1)) == 0)
+    return;
+  if(c != 2)
+    c = xchg(&l->locked, 2);
+  while(c != 0){
+    futexwait(&l->locked, 2);
+    c = xchg(&l->locked, 2);
+  }
+}
+
+void
+lock_release(struct ulock *l)
+{
+  if(xchg(&l->locked, 0) == 2)
+    futexwake(&l->locked, 1);
+}
+
+void
+cond_init(struct ucond *c)
+{
+  c->seq = 0;
+}
+
+// Release l, wait for a signal on c, and retake l.
+// As with any condition variable, callers must recheck
+// their condition in a loop.
+void
+cond_wait(struct ucond *c, struct ulock *l)
+{
+  uint seq;
+
+  seq = c->seq;
+  lock_release(l);
+  futexwait(&c->seq, seq);
+  // Others may have been woken by a broadcast; take the
+  // lock as contended so none of their wakeups are lost.
+  while(xchg(&l->locked, 2) != 0)
+    futexwait(&l->locked, 2);
+}
+
+void
+cond_signal(struct ucond *c)
+{
+  atomic_add(&c->seq, 1);
+  futexwake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct ucond *c)
+{
+  atomic_add(&c->seq, 1);
+  futexwake(&c->seq, NTHREAD);
+}
+
+// First code run by a new thread; the tinfo sits at the top
+// of its stack.
+static void
+thread_start(void *a)
+{
+  struct tinfo *t;
+
+  t = a;
+  t->fn(t->arg);
+  exit();
+}
+
+// Start a thread running fn(arg).  Return its thread id or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  char *stack;
+  struct tinfo *t;
+  int i, tid;
+
+  lock_acquire(&threads.lock);
+  for(i = 0; i < NTHREAD; i++)
+    if(threads.stack[i] == 0)
+      break;
+  if(i == NTHREAD || (stack = malloc(TSTACKSIZE)) == 0){
+    lock_release(&threads.lock);
+    return -1;
+  }
+  t = (struct tinfo*)(stack + TSTACKSIZE) - 1;
+  t->fn = fn;
+  t->arg = arg;
+  if((tid = clone(thread_start, t, t)) < 0){
+    free(stack);
+    lock_release(&threads.lock);
+    return -1;
+  }
+  threads.tid[i] = tid;
+  threads.stack[i] = stack;
+  lock_release(&threads.lock);
+  return tid;
+}
+
+// Wait for a thread to exit and free its stack.
+// Return its thread id, or -1 if there are no other threads.
+int
+thread_join(void)
+{
+  int i, tid;
+
+  if((tid = join()) < 0)
+    return -1;
+  lock_acquire(&threads.lock);
+  for(i = 0; i < NTHREAD; i++){
+    if(threads.stack[i] && threads.tid[i] == tid){
+      free(threads.stack[i]);
+      threads.stack[i] = 0;
+      break;
+    }
+  }
+  lock_release(&threads.lock);
+  return tid;
+}
@@ -0,0 +1,15 @@
+// The vdso: two read-only pages the kernel maps at the top of
+// every process's address space so that user code can read the
+// time without a system call.  The first holds struct vdso,
+// the second is the system timer's registers.  The pid is in
+// the user read-only thread ID register (TPIDRURO) instead,
+// since threads share the pages.
+// Both the kernel and user programs use this header file.
+
+#define VDSOBASE    0x3FFFE000            // USERBOUND - 2 pages
+#define VDSOTIMER   (VDSOBASE + 0x1000)   // system timer registers
+#define VDSOCLO     (VDSOTIMER + 4)       // its 1MHz counter, low word
+
+struct vdso {
+  volatile uint ticks;    // as returned by uptime()
+};
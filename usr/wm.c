@@ -304,39 +304,82 @@ void focus_window(int idx)
     focused_pid=tmp.pid;
 }
 
+/* ==================================================
+ * THREADS
+ * ================================================== */
+
+/* wmlock protects windows[], focused_pid and the framebuffer. */
+struct ulock wmlock;
+int fb_fd;
+
+window_t *find_window(int pid)
+{
+    for(int i=0;i<num_windows;i++)
+        if(windows[i].pid==pid)
+            return &windows[i];
+    return 0;
+}
+
+/* One per window: copy the program's output into its window. */
+void window_thread(void *arg)
+{
+    int pid = (int)arg;
+    int fd;
+    char buf[64];
+    int n;
+
+    lock_acquire(&wmlock);
+    fd = find_window(pid)->stdout_pipe[0];
+    lock_release(&wmlock);
+
+    while((n = read(fd,buf,sizeof(buf))) > 0){
+        lock_acquire(&wmlock);
+        window_t *w = find_window(pid);
+        for(int j=0;j<n;j++)
+            window_put_char(w,buf[j]);
+        blit_window_rects(fb_fd,w-windows);
+        lock_release(&wmlock);
+    }
+}
+
 /* ==================================================
  * MAIN LOOP
  * ================================================== */
 
 int main(void)
 {
-    int fb_fd = open(FB_DEVICE,O_WRONLY);
+    fb_fd = open(FB_DEVICE,O_WRONLY);
     int kb_fd = open(KB_DEVICE,O_RDONLY);
 
+    lock_init(&wmlock);
     start_process_in_window("sh",50,50);
     start_process_in_window("sh",500,50);
 
     redraw_all(fb_fd);
 
+    /* Threads copy the fd table, so start them after all pipes exist. */
+    for(int i=0;i<num_windows;i++)
+        thread_create(window_thread,(void*)windows[i].pid);
+
+    /* The main thread handles input. */
     while(1){
         char c;
-        if(read(kb_fd,&c,1)==1){
-            if(c=='1'){ focus_window(0); redraw_all(fb_fd); continue; }
-            if(c=='2'){ focus_window(1); redraw_all(fb_fd); continue; }
-
-            for(int i=0;i<num_windows;i++)
-                if(windows[i].pid==focused_pid)
-                    write(windows[i].pipefd[1],&c,1);
+        int fd = -1;
+        if(read(kb_fd,&c,1)!=1)
+            continue;
+
+        lock_acquire(&wmlock);
+        if(c=='1' || c=='2'){
+            focus_window(c-'1');
+            redraw_all(fb_fd);
+        } else {
+            window_t *w = find_window(focused_pid);
+            if(w)
+                fd = w->pipefd[1];
         }
+        lock_release(&wmlock);
 
-        for(int i=0;i<num_windows;i++){
-            char buf[64];
-            int n = read(windows[i].stdout_pipe[0],buf,sizeof(buf));
-            if(n>0){
-                for(int j=0;j<n;j++)
-                    window_put_char(&windows[i],buf[j]);
-                blit_window_rects(fb_fd,i);
-            }
-        }
+        if(fd >= 0)
+            write(fd,&c,1);
     }
 }
@@ -0,0 +1,174 @@
+// Lazy VFP context switching.
+//
+// The VFP unit is left disabled whenever a cpu switches
+// processes.  The first VFP instruction a process then executes
+// is undefined, and vfptrap() enables the unit, saves the
+// previous user's registers into its struct proc and loads the
+// current process's, and lets the instruction run again.
+// Processes that never touch floating point cost nothing.
+//
+// On the single-core BCM2835 a process's registers may stay in
+// the unit while others run, and if nobody else used it in the
+// meantime it gets them back without trapping.  With several
+// cpus a process can move, so its registers are saved when it
+// is switched out if it used the unit during its time slice.
+//
+// The kernel itself is built for soft float and never uses VFP.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "arm.h"
+
+#define FPEXC_EN	(1 << 30)
+#define FPEXC_EX	(1 << 31)
+// RunFast mode (flush to zero, default NaN, no trapped
+// exceptions): the VFP11 then does all arithmetic in hardware
+// and never bounces an instruction to support code.
+#define FPSCR_RUNFAST	((1 << 24) | (1 << 25))
+
+static inline uint
+fpexcread(void)
+{
+  uint v;
+
+  asm volatile("mrc p10, 7, %0, cr8, cr0, 0" : "=r"(v)); // vmrs fpexc
+  return v;
+}
+
+static inline void
+fpexcwrite(uint v)
+{
+  asm volatile("mcr p10, 7, %0, cr8, cr0, 0" : : "r"(v)); // vmsr fpexc
+}
+
+// Only with the unit enabled.
+static void
+vfpsave(struct vfpstate *s)
+{
+  asm volatile("stc p11, cr0, [%0], {32}" : : "r"(s->d) : "memory"); // vstmia d0-d15
+  asm volatile("mrc p10, 7, %0, cr1, cr0, 0" : "=r"(s->fpscr));    // vmrs fpscr
+}
+
+static void
+vfprestore(struct vfpstate *s)
+{
+  asm volatile("ldc p11, cr0, [%0], {32}" : : "r"(s->d) : "memory"); // vldmia d0-d15
+  asm volatile("mcr p10, 7, %0, cr1, cr0, 0" : : "r"(s->fpscr));    // vmsr fpscr
+}
+
+// Give user mode access to cp10 and cp11 and leave the unit
+// off until a process uses it.  Every cpu calls this.
+void
+vfpinit(void)
+{
+  uint cpacr;
+
+  asm volatile("mrc p15, 0, %0, c1, c0, 2" : "=r"(cpacr));
+  cpacr |= 0xF << 20;
+  asm volatile("mcr p15, 0, %0, c1, c0, 2" : : "r"(cpacr));
+  asm volatile("mcr p15, 0, %0, c7, c5, 4" : : "r"(0)); // flush prefetch buffer
+  fpexcwrite(0);
+  curr_cpu->vfpowner = 0;
+}
+
+// Is instr a VFP instruction, that is an ARM coprocessor
+// instruction for cp10 or cp11?
+static int
+isvfp(uint instr)
+{
+  if((instr & 0x0E000000) != 0x0C000000 && (instr & 0x0F000000) != 0x0E000000)
+    return 0;
+  return (instr & 0xE00) == 0xA00;
+}
+
+// Undefined instruction from user mode.  Return 1 if it was the
+// first VFP instruction since a switch and should be retried.
+int
+vfptrap(struct trapframe *tf)
+{
+  struct cpu *c;
+  struct proc *p;
+  uint instr;
+
+  p = curr_proc;
+  if((tf->spsr & 0x20) || tf->pc >= p->sz || (tf->pc & 3))
+    return 0;    // Thumb, or not ours to read
+  instr = *(uint*)tf->pc;
+  if(!isvfp(instr))
+    return 0;
+  if(fpexcread() & FPEXC_EN){
+    // Enabled already: a real undefined instruction, or an
+    // exception the VFP11 bounced (not in RunFast mode).
+    if(fpexcread() & FPEXC_EX)
+      cprintf("pid %d %s: vfp exception\n", p->pid, p->name);
+    return 0;
+  }
+
+  // Interrupts are off, so we stay on this cpu.
+  c = curr_cpu;
+  fpexcwrite(FPEXC_EN);
+  if(c->vfpowner != p){
+    if(c->vfpowner)
+      vfpsave(&c->vfpowner->vfp);
+    if(!p->usedvfp){
+      memset(&p->vfp, 0, sizeof(p->vfp));
+      p->vfp.fpscr = FPSCR_RUNFAST;
+      p->usedvfp = 1;
+    }
+    vfprestore(&p->vfp);
+    c->vfpowner = p;
+  }
+  return 1;
+}
+
+// The scheduler is about to run p on this cpu.
+void
+vfpswitchin(struct proc *p)
+{
+  // Its registers are still in the unit: no need to trap.
+  fpexcwrite(curr_cpu->vfpowner == p ? FPEXC_EN : 0);
+}
+
+// p has stopped running on this cpu.
+void
+vfpswitchout(struct proc *p)
+{
+#ifdef RPI2
+  if(fpexcread() & FPEXC_EN){
+    vfpsave(&p->vfp);
+    curr_cpu->vfpowner = 0;
+  }
+#endif
+  fpexcwrite(0);
+}
+
+// Bring p->vfp up to date; p is the current process.
+void
+vfpflush(struct proc *p)
+{
+  pushcli();
+  if(curr_cpu->vfpowner == p && (fpexcread() & FPEXC_EN))
+    vfpsave(&p->vfp);
+  popcli();
+}
+
+// Forget p's registers (exec, exit).  Caller holds ptable.lock
+// or p is the current process.
+void
+vfpforget(struct proc *p)
+{
+  struct cpu *c;
+
+  pushcli();
+  for(c = cpus; c < &cpus[NCPU]; c++)
+    if(c->vfpowner == p)
+      c->vfpowner = 0;
+  p->usedvfp = 0;
+  if(curr_cpu->proc == p)
+    fpexcwrite(0);  // so its next VFP instruction traps
+  popcli();
+}
@@ -15,11 +15,13 @@
 #include "mmu.h"
 #include "proc.h"
 #include "elf.h"
+#include "vdso.h"
 
 extern char data[];  // defined by kernel.ld
 extern char end[];  // defined by kernel.ld
 
 pde_t *kpgdir;  // for use in scheduler()
+struct vdso *vdso;  // mapped at VDSOBASE in every process
 
 // Return the address of the PTE in page table pgdir
 // that corresponds to virtual address va.  If alloc!=0,
@@ -94,8 +96,10 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, uint l1attr, uint l2attr)
 // 
 // setupkvm() and exec() set up every page table like this:
 //
-//   0..KERNBASE: user memory (text+data+stack+heap), mapped to
+//   0..VDSOBASE: user memory (text+data+stack+heap), mapped to
 //                phys memory allocated by the kernel
+//   VDSOBASE..USERBOUND: the vdso page and the system timer,
+//                read-only (see vdso.h)
 //   KERNBASE..KERNBASE+EXTMEM: mapped to 0..EXTMEM (for I/O space)
 //   KERNBASE+EXTMEM..data: mapped to EXTMEM..V2P(data)
 //                for the kernel's instructions and r/o data
@@ -135,9 +139,26 @@ setupkvm(void)
 //cprintf("inside setupkvm: pgdir=%x\n", pgdir);
   memset(pgdir, 0, PGSIZE);
 //cprintf("after memset\n", pgdir);
+  if(mappages(pgdir, (void*)VDSOBASE, PGSIZE, v2p(vdso), UVMPDXATTR,
+              PTX_AP(U_AP)|CACHED|BUFFERED|SMALL|PTX_SHARED) < 0 ||
+     mappages(pgdir, (void*)VDSOTIMER, PGSIZE, PHYSIO+0x3000, UVMPDXATTR,
+              PTX_AP(U_AP)|SMALL) < 0){
+    freevm(pgdir);
+    return 0;
+  }
   return pgdir;
 }
 
+// Allocate the vdso page, which the timer interrupt keeps
+// up to date.
+void
+vdsoinit(void)
+{
+  if((vdso = (struct vdso*)kalloc()) == 0)
+    panic("vdsoinit");
+  memset(vdso, 0, PGSIZE);
+}
+
 
 // Set up kernel part of a page table.
 pde_t*
@@ -174,8 +195,9 @@ kvmalloc(void)
 void
 switchkvm(void)
 {
-// do nothing here as the same pgdir is shared between kernel and user;
-// will see if the user portion of the pgdir should be removed.
+  // kpgdir maps nothing below USERBOUND, so a TTBR0 pointing at it
+  // leaves only the kernel.  The next switchuvm flushes the TLB.
+  set_pgtbase(v2p(kpgdir)|TTB_ATTR);
 }
 
 void
@@ -191,6 +213,19 @@ switchkvm_new(void)
   //cprintf("after flush_tlb\n");
 }
 
+// Invalidate the TLBs of every cpu, after unmapping user pages
+// that threads running on other cpus may still have cached.
+void
+flush_tlb_all(void)
+{
+#ifdef RPI2
+  asm volatile("mcr p15, 0, %0, c8, c3, 0" : : "r"(0) : "memory"); // inner shareable
+  dsb_barrier();
+#else
+  flush_tlb();
+#endif
+}
+
 // Switch TSS and h/w page table to correspond to process p.
 void
 switchuvm(struct proc *p)
@@ -199,10 +234,13 @@ switchuvm(struct proc *p)
   //cpu->ts.esp0 = (uint)proc->kstack + KSTACKSIZE;
   if(p->pgdir == 0)
     panic("switchuvm: no pgdir");
-//cprintf("before copying uvm to kvm kpgdir=%x the first entry: %x\n", kpgdir, kpgdir[0]);
-  memmove((void *)kpgdir, (void *)p->pgdir, PGSIZE);  // switch to new user address space
+  // User space is translated through TTBR0 (see TTBCR_N), so each
+  // cpu just points its own TTBR0 at the process's 4KB pgdir.
   flush_idcache();
+  set_pgtbase(v2p(p->pgdir)|TTB_ATTR);
   flush_tlb();
+  // The user read-only thread ID register, for vgetpid().
+  asm volatile("mcr p15, 0, %0, c13, c0, 3" : : "r"(p->pid));
   popcli();
 }
 
@@ -257,7 +295,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= USERBOUND)
+  if(newsz > VDSOBASE)
     return 0;
   if(newsz < oldsz)
     return oldsz;
@@ -315,7 +353,7 @@ freevm(pde_t *pgdir)
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
-  deallocuvm(pgdir, USERBOUND, 0);
+  deallocuvm(pgdir, VDSOBASE, 0);  // the vdso pages are not ours
   for(i = 0; i < NPDENTRIES; i++){
     if((uint)pgdir[i] != 0){
       char * v = p2v(PTE_ADDR(pgdir[i]));